@@ -4,6 +4,7 @@
 #include "math.h"
 #include "raylib.h"
 #include "blackboard.h"
+#include "pathQuery.h"
 
 struct CompoundNode : public BehNode
 {
@@ -155,8 +156,10 @@ struct MoveToEntity : public BehNode
         res = BEH_FAIL;
         return;
       }
+      Position targetPos = pos;
       targetEntity.get([&](const Position &target_pos)
       {
+        targetPos = target_pos;
         if (pos != target_pos)
         {
           a.action = move_towards(pos, target_pos);
@@ -165,6 +168,17 @@ struct MoveToEntity : public BehNode
         else
           res = BEH_SUCCESS;
       });
+      if (res != BEH_RUNNING)
+        return;
+      // walk a path found for this target while it still ends there and walker is still on it
+      PathToTarget *path = entity.get_mut<PathToTarget>();
+      if (!path || path->target != targetEntity || path->tiles.empty() || path->tiles.back() != targetPos)
+        return;
+      while (path->next < path->tiles.size() && path->tiles[path->next] == pos)
+        ++path->next;
+      if (path->next < path->tiles.size() &&
+          abs(path->tiles[path->next].x - pos.x) + abs(path->tiles[path->next].y - pos.y) == 1)
+        a.action = move_towards(pos, path->tiles[path->next]);
     });
     return res;
   }
@@ -233,28 +247,20 @@ struct FindPickUp : public BehNode
   BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) override
   {
     BehResult res = BEH_FAIL;
-    static auto pickUpQuery = ecs.query<const Position, const IsPickUp>();
-    entity.set([&](const Position &pos)
+    std::vector<Position> path;
+    flecs::entity closestPickUpEntity;
+    entity.get([&](const Position &pos)
     {
-      float closestDist = FLT_MAX;
-      Position closestPos;
-      flecs::entity closestPickUpEntity;
-      pickUpQuery.each([&](flecs::entity pickUpEntity, const Position &hpos, const IsPickUp &)
-      {
-        float curDist = dist(hpos, pos);
-        if (curDist < closestDist)
-        {
-          closestPos = hpos;
-          closestDist = curDist;
-          closestPickUpEntity = pickUpEntity;
-        }
-      });
-      if (closestDist < FLT_MAX)
+      // nearest by path, one search for all pickups, move_to_entity walks the path found
+      closestPickUpEntity = path_query::find_nearest_with<IsPickUp>(ecs, entity, pos, path);
+      if (ecs.is_valid(closestPickUpEntity))
       {
         bb.set<flecs::entity>(nextPickUpBb, closestPickUpEntity);
         res = BEH_SUCCESS;
       }
     });
+    if (res == BEH_SUCCESS)
+      entity.set(PathToTarget{closestPickUpEntity, std::move(path)});
     return res;
   }
 };
@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 
 struct Position;
 struct MovePos;
@@ -114,6 +115,14 @@ struct Waypoint
   flecs::entity next;
 };
 
+// path found by a path query, tiles go from the one next to the walker up to the target
+struct PathToTarget
+{
+  flecs::entity target;
+  std::vector<Position> tiles;
+  size_t next = 0;
+};
+
 struct Team
 {
   int team = 0;
@@ -0,0 +1,73 @@
+#include "pathQuery.h"
+#include <algorithm>
+#include <queue>
+
+bool path_query::find_nearest(const Position &from, const std::vector<Position> &goals, const std::vector<Position> &blockers,
+                              size_t &goal_idx, std::vector<Position> &path)
+{
+  path.clear();
+  if (goals.empty())
+    return false;
+  int minX = from.x, minY = from.y, maxX = from.x, maxY = from.y;
+  auto grow = [&](const Position &p)
+  {
+    minX = std::min(minX, p.x);
+    minY = std::min(minY, p.y);
+    maxX = std::max(maxX, p.x);
+    maxY = std::max(maxY, p.y);
+  };
+  for (const Position &p : goals)
+    grow(p);
+  for (const Position &p : blockers)
+    grow(p);
+  minX -= 1; minY -= 1; maxX += 1; maxY += 1;
+  const size_t width = size_t(maxX - minX + 1);
+  const size_t height = size_t(maxY - minY + 1);
+  auto to_idx = [&](const Position &p) { return size_t(p.y - minY) * width + size_t(p.x - minX); };
+
+  constexpr size_t no_goal = size_t(-1);
+  constexpr size_t unvisited = size_t(-1);
+  std::vector<size_t> goalAt(width * height, no_goal);
+  std::vector<bool> blocked(width * height, false);
+  for (const Position &p : blockers)
+    blocked[to_idx(p)] = true;
+  for (size_t i = 0; i < goals.size(); ++i)
+    if (goalAt[to_idx(goals[i])] == no_goal)
+      goalAt[to_idx(goals[i])] = i;
+
+  std::vector<size_t> prev(width * height, unvisited);
+  std::queue<size_t> openList;
+  const size_t start = to_idx(from);
+  prev[start] = start;
+  openList.push(start);
+  while (!openList.empty())
+  {
+    const size_t idx = openList.front();
+    openList.pop();
+    if (goalAt[idx] != no_goal)
+    {
+      goal_idx = goalAt[idx];
+      for (size_t cur = idx; cur != start; cur = prev[cur])
+        path.push_back(Position{int(cur % width) + minX, int(cur / width) + minY});
+      std::reverse(path.begin(), path.end());
+      return true;
+    }
+    const size_t x = idx % width;
+    const size_t y = idx / width;
+    auto visit = [&](size_t nx, size_t ny)
+    {
+      if (nx >= width || ny >= height)
+        return;
+      const size_t nidx = ny * width + nx;
+      if (prev[nidx] != unvisited || (blocked[nidx] && goalAt[nidx] == no_goal))
+        return;
+      prev[nidx] = idx;
+      openList.push(nidx);
+    };
+    visit(x - 1, y);
+    visit(x + 1, y);
+    visit(x, y - 1);
+    visit(x, y + 1);
+  }
+  return false;
+}
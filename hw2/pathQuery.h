@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <flecs.h>
+#include "ecsTypes.h"
+
+namespace path_query
+{
+  // one breadth first search from start to whichever goal is reached first, goal tiles are enterable even if blocked,
+  // grid is open so search is kept in bounding box of all given tiles grown by one, shortest paths never leave it,
+  // path goes from tile next to start up to goal, returns false if no goal is reachable
+  bool find_nearest(const Position &from, const std::vector<Position> &goals, const std::vector<Position> &blockers,
+                    size_t &goal_idx, std::vector<Position> &path);
+
+  // nearest entity with Filter component, characters except agent block the way
+  template<typename Filter>
+  flecs::entity find_nearest_with(flecs::world &ecs, flecs::entity agent, const Position &from, std::vector<Position> &path)
+  {
+    static auto goalsQuery = ecs.query<const Position, const Filter>();
+    static auto blockersQuery = ecs.query<const Position, const Hitpoints>();
+    std::vector<Position> goals;
+    std::vector<flecs::entity> goalEntities;
+    goalsQuery.each([&](flecs::entity e, const Position &pos, const Filter &)
+    {
+      goals.push_back(pos);
+      goalEntities.push_back(e);
+    });
+    std::vector<Position> blockers;
+    blockersQuery.each([&](flecs::entity e, const Position &pos, const Hitpoints &)
+    {
+      if (e != agent)
+        blockers.push_back(pos);
+    });
+    size_t goalIdx = 0;
+    if (!find_nearest(from, goals, blockers, goalIdx, path))
+      return flecs::entity();
+    return goalEntities[goalIdx];
+  }
+};
@@ -22,7 +22,7 @@ public:
   {
     on_closest_enemy_pos(ecs, entity, [&](Action &a, const Position &pos, const Position &enemy_pos)
     {
-      a.action = move_towards(pos, enemy_pos);
+      a.action = chase_move(ecs, entity, pos, enemy_pos);
     });
   }
 };
@@ -79,17 +79,12 @@ public:
   EnemyAvailableTransition(float in_dist) : triggerDist(in_dist) {}
   bool isAvailable(flecs::world &ecs, flecs::entity entity) const override
   {
-    static auto enemiesQuery = ecs.query<const Position, const Team>();
+    const NearestTeamField *field = ecs.get<NearestTeamField>();
     bool enemiesFound = false;
     entity.get([&](const Position &pos, const Team &t)
     {
-      enemiesQuery.each([&](const Position &epos, const Team &et)
-      {
-        if (t.team == et.team)
-          return;
-        float curDist = dist(epos, pos);
-        enemiesFound |= curDist <= triggerDist;
-      });
+      if (field)
+        enemiesFound = dmaps::closest_enemy(*field, pos, t.team).dist <= triggerDist;
     });
     return enemiesFound;
   }
@@ -1,7 +1,8 @@
 #pragma once
 #include <flecs.h>
 #include "blackboard.h"
-#include <float.h>
+#include "dijkstraMapGen.h"
+#include "dstarLite.h"
 #include "math.h"
 
 template<typename T, typename U>
@@ -14,6 +15,24 @@ inline int move_towards(const T &from, const U &to)
   return deltaY < 0 ? EA_MOVE_UP : EA_MOVE_DOWN;
 }
 
+// follows entity's ChasePath around walls, straight move if it has none or target is unreachable
+inline int chase_move(flecs::world &ecs, flecs::entity entity, const Position &from, const Position &to)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData>();
+  int res = move_towards(from, to);
+  ChasePath *chase = entity.get_mut<ChasePath>();
+  if (!chase)
+    return res;
+  dungeonDataQuery.each([&](const DungeonData &dd)
+  {
+    const size_t next = dstar::next_tile(*chase, dd, size_t(from.y) * dd.width + size_t(from.x),
+                                        size_t(to.y) * dd.width + size_t(to.x));
+    if (next != DStarLite::no_tile)
+      res = move_towards(from, Position{int(next % dd.width), int(next / dd.width)});
+  });
+  return res;
+}
+
 inline int inverse_move(int move)
 {
   return move == EA_MOVE_LEFT ? EA_MOVE_RIGHT :
@@ -25,26 +44,16 @@ inline int inverse_move(int move)
 template<typename Callable>
 inline void on_closest_enemy_pos(flecs::world &ecs, flecs::entity entity, Callable c)
 {
-  static auto enemiesQuery = ecs.query<const Position, const Team>();
+  const NearestTeamField *field = ecs.get<NearestTeamField>();
+  if (!field)
+    return;
   entity.set([&](const Position &pos, const Team &t, Action &a)
   {
-    flecs::entity closestEnemy;
-    float closestDist = FLT_MAX;
-    Position closestPos;
-    enemiesQuery.each([&](flecs::entity enemy, const Position &epos, const Team &et)
-    {
-      if (t.team == et.team)
-        return;
-      float curDist = dist(epos, pos);
-      if (curDist < closestDist)
-      {
-        closestDist = curDist;
-        closestPos = epos;
-        closestEnemy = enemy;
-      }
-    });
-    if (ecs.is_valid(closestEnemy))
-      c(a, pos, closestPos);
+    const dmaps::ClosestMember closest = dmaps::closest_enemy(*field, pos, t.team);
+    if (!closest.entity || !ecs.is_valid(ecs.entity(closest.entity)))
+      return;
+    if (const Position *closestPos = ecs.entity(closest.entity).get<Position>())
+      c(a, pos, *closestPos);
   });
 }
 
@@ -87,7 +87,7 @@ struct MoveToEntity : public BehNode
     entityBb = reg_entity_blackboard_var<flecs::entity>(entity, bb_name);
   }
 
-  BehResult update(flecs::world &, flecs::entity entity, Blackboard &bb) override
+  BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) override
   {
     BehResult res = BEH_RUNNING;
     entity.set([&](Action &a, const Position &pos)
@@ -102,7 +102,7 @@ struct MoveToEntity : public BehNode
       {
         if (pos != target_pos)
         {
-          a.action = move_towards(pos, target_pos);
+          a.action = chase_move(ecs, entity, pos, target_pos);
           res = BEH_RUNNING;
         }
         else
@@ -140,25 +140,14 @@ struct FindEnemy : public BehNode
   BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) override
   {
     BehResult res = BEH_FAIL;
-    static auto enemiesQuery = ecs.query<const Position, const Team>();
-    entity.set([&](const Position &pos, const Team &t)
+    const NearestTeamField *field = ecs.get<NearestTeamField>();
+    if (!field)
+      return res;
+    entity.get([&](const Position &pos, const Team &t)
     {
-      flecs::entity closestEnemy;
-      float closestDist = FLT_MAX;
-      Position closestPos;
-      enemiesQuery.each([&](flecs::entity enemy, const Position &epos, const Team &et)
-      {
-        if (t.team == et.team)
-          return;
-        float curDist = dist(epos, pos);
-        if (curDist < closestDist)
-        {
-          closestDist = curDist;
-          closestPos = epos;
-          closestEnemy = enemy;
-        }
-      });
-      if (ecs.is_valid(closestEnemy) && closestDist <= distance)
+      const dmaps::ClosestMember closest = dmaps::closest_enemy(*field, pos, t.team);
+      flecs::entity closestEnemy = ecs.entity(closest.entity);
+      if (closest.entity && ecs.is_valid(closestEnemy) && closest.dist <= distance)
       {
         bb.set<flecs::entity>(entityBb, closestEnemy);
         res = BEH_SUCCESS;
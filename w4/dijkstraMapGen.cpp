@@ -1,7 +1,15 @@
 #include "dijkstraMapGen.h"
 #include "ecsTypes.h"
 #include "dungeonUtils.h"
+#include "dmapFollower.h"
+#include "fieldOfView.h"
+#include "exploration.h"
+#include "math.h"
 #include <cmath>
+#include <algorithm>
+#include <unordered_set>
+#include <future>
+#include <queue>
 
 template<typename Callable>
 static void query_dungeon_data(flecs::world &ecs, Callable c)
@@ -27,7 +35,7 @@ static void query_player_position(flecs::world &ecs, Callable c)
   playerPositionQuery.each(c);
 }
 
-constexpr float invalid_tile_value = 1e5f;
+using dmaps::invalid_tile_value;
 
 static void init_tiles(std::vector<float> &map, const DungeonData &dd)
 {
@@ -87,154 +95,336 @@ static void process_dmap(std::vector<float> &map, const DungeonData &dd, const D
     }
 }
 
-void dmaps::gen_player_approach_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params)
+DijkstraMapData dmaps::quantize_map(const std::vector<float> &map)
 {
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
-  {
-    init_tiles(map, dd);
-    query_characters_positions(ecs, [&](const Position &pos, const Team &t)
+  DijkstraMapData res;
+  float minVal = invalid_tile_value;
+  float maxVal = -invalid_tile_value;
+  for (float v : map)
+    if (v < invalid_tile_value)
     {
-      if (t.team == 0) // player team hardcode
-        map[pos.y * dd.width + pos.x] = 0.f;
-    });
-    process_dmap(map, dd, params);
+      minVal = std::min(minVal, v);
+      maxVal = std::max(maxVal, v);
+    }
+  constexpr float maxSteps = float(DijkstraMapData::invalid_tile - 1);
+  res.offset = minVal < invalid_tile_value ? minVal : 0.f;
+  res.scale = maxVal > minVal ? (maxVal - minVal) / maxSteps : 1.f;
+  res.map.resize(map.size());
+  for (size_t i = 0; i < map.size(); ++i)
+    res.map[i] = map[i] < invalid_tile_value ? uint16_t(lroundf((map[i] - res.offset) / res.scale))
+                                             : DijkstraMapData::invalid_tile;
+  return res;
+}
+
+static void init_seeded_tiles(std::vector<float> &map, const DungeonData &dd, const dmaps::Seeds &seeds)
+{
+  init_tiles(map, dd);
+  for (size_t idx : seeds.tiles)
+    map[idx] = 0.f;
+}
+
+static void build_from_seeds(const DungeonData &dd, const dmaps::Seeds &seeds, const DmapParams &params, std::vector<float> &map)
+{
+  init_seeded_tiles(map, dd, seeds);
+  process_dmap(map, dd, params);
+}
+
+static void gather_player_team(flecs::world &ecs, const DungeonData &dd, dmaps::Seeds &seeds)
+{
+  query_characters_positions(ecs, [&](const Position &pos, const Team &t)
+  {
+    if (t.team == 0) // player team hardcode
+      seeds.tiles.push_back(size_t(pos.y) * dd.width + size_t(pos.x));
   });
 }
 
-void dmaps::gen_player_flee_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params)
+static void build_player_flee_map(const DungeonData &dd, const dmaps::Seeds &seeds, const DmapParams &params, std::vector<float> &map)
 {
-  gen_player_approach_map(ecs, map, params);
+  build_from_seeds(dd, seeds, params, map);
   for (float &v : map)
     if (v < invalid_tile_value)
       v *= -1.2f;
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
+  process_dmap(map, dd, params);
+}
+
+static void gather_hives(flecs::world &ecs, const DungeonData &dd, dmaps::Seeds &seeds)
+{
+  static auto hiveQuery = ecs.query<const Position, const Hive>();
+  hiveQuery.each([&](const Position &pos, const Hive &)
   {
-    process_dmap(map, dd, params);
+    seeds.tiles.push_back(size_t(pos.y) * dd.width + size_t(pos.x));
   });
 }
 
-void dmaps::gen_hive_pack_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params)
+static void gather_unresearched(flecs::world &ecs, const DungeonData &, dmaps::Seeds &seeds)
 {
-  static auto hiveQuery = ecs.query<const Position, const Hive>();
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
+  const ExplorationMap *fog = ecs.get<ExplorationMap>();
+  if (fog)
+    exploration::collect_tiles(*fog, 0, false, seeds.tiles); // player team hardcode
+}
+
+static void gather_archer_positions(flecs::world &ecs, const DungeonData &dd, dmaps::Seeds &seeds)
+{
+  static auto fovCacheQuery = ecs.query<FovCache>();
+  fovCacheQuery.each([&](FovCache &cache)
   {
-    init_tiles(map, dd);
-    hiveQuery.each([&](const Position &pos, const Hive &)
+    query_player_position(ecs, [&](const Position &pos, const IsPlayer)
     {
-      map[pos.y * dd.width + pos.x] = 0.f;
+      // shoot from the farthest visible tiles within range
+      const std::vector<size_t> &visible = fov::visible_tiles(cache, dd, pos, dungeon::rangeDistance);
+      float maxDist = 0.f;
+      for (size_t idx : visible)
+        if (dd.tiles[idx] == dungeon::floor)
+          maxDist = std::max(maxDist, dist(pos, Position{int(idx % dd.width), int(idx / dd.width)}));
+      for (size_t idx : visible)
+        if (dd.tiles[idx] == dungeon::floor &&
+            dist(pos, Position{int(idx % dd.width), int(idx / dd.width)}) > maxDist - 1.f)
+          seeds.tiles.push_back(idx);
     });
-    process_dmap(map, dd, params);
   });
 }
 
-void dmaps::gen_research_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params)
+static void gather_visible_monsters(flecs::world &ecs, const DungeonData &dd, dmaps::Seeds &seeds)
 {
-  static auto dungeonDataQuery = ecs.query<DungeonData>();
-  dungeonDataQuery.each([&](DungeonData &dd)
+  const ExplorationMap *fog = ecs.get<ExplorationMap>();
+  if (!fog)
+    return;
+  query_characters_positions(ecs, [&](const Position &pos, const Team &t)
   {
-    init_tiles(map, dd);
-    query_player_position(ecs, [&](const Position &pos, const IsPlayer)
+    if (t.team == 1 && fog->is_explored(0, size_t(pos.x), size_t(pos.y))) // monster team hardcode
+      seeds.tiles.push_back(size_t(pos.y) * dd.width + size_t(pos.x));
+  });
+  // without enemies map is flat over researched tiles
+  if (seeds.tiles.empty())
+  {
+    exploration::collect_tiles(*fog, 0, true, seeds.tiles);
+    seeds.propagate = false;
+  }
+}
+
+static void build_flee_from_monster_map(const DungeonData &dd, const dmaps::Seeds &seeds, const DmapParams &params, std::vector<float> &map)
+{
+  init_seeded_tiles(map, dd, seeds);
+  if (!seeds.propagate)
+    return;
+  process_dmap(map, dd, params);
+  for (float &v : map)
+    if (v < invalid_tile_value)
+      v *= -1.2f;
+}
+
+static flecs::entity add_generator(flecs::world &ecs, const char *name, dmaps::gather_function gather,
+                                   dmaps::build_function build, const DmapParams &params)
+{
+  return ecs.entity(name)
+    .set(DmapGenerator{gather, build, params});
+}
+
+flecs::entity dmaps::add_player_approach_map(flecs::world &ecs, const char *name, const DmapParams &params)
+{
+  return add_generator(ecs, name, gather_player_team, build_from_seeds, params);
+}
+
+flecs::entity dmaps::add_player_flee_map(flecs::world &ecs, const char *name, const DmapParams &params)
+{
+  return add_generator(ecs, name, gather_player_team, build_player_flee_map, params);
+}
+
+flecs::entity dmaps::add_hive_pack_map(flecs::world &ecs, const char *name, const DmapParams &params)
+{
+  return add_generator(ecs, name, gather_hives, build_from_seeds, params);
+}
+
+flecs::entity dmaps::add_research_map(flecs::world &ecs, const char *name, const DmapParams &params)
+{
+  return add_generator(ecs, name, gather_unresearched, build_from_seeds, params);
+}
+
+flecs::entity dmaps::add_archer_map(flecs::world &ecs, const char *name, const DmapParams &params)
+{
+  return add_generator(ecs, name, gather_archer_positions, build_from_seeds, params);
+}
+
+flecs::entity dmaps::add_flee_from_monster_map(flecs::world &ecs, const char *name, const DmapParams &params)
+{
+  return add_generator(ecs, name, gather_visible_monsters, build_flee_from_monster_map, params);
+}
+
+static size_t hash_seeds(dmaps::Seeds &seeds)
+{
+  std::sort(seeds.tiles.begin(), seeds.tiles.end());
+  size_t hash = std::hash<bool>{}(seeds.propagate);
+  for (size_t idx : seeds.tiles)
+    hash ^= std::hash<size_t>{}(idx) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  return hash ^ seeds.tiles.size();
+}
+
+struct MapBuildJob
+{
+  flecs::entity map;
+  dmaps::build_function build;
+  DmapParams params;
+  dmaps::Seeds seeds;
+};
+
+using BuiltMaps = std::vector<std::pair<flecs::entity, DijkstraMapData>>;
+
+// at most one build is in flight, it is published at the start of the next turn
+static std::future<BuiltMaps> pendingMaps;
+
+std::unordered_set<flecs::entity_t> dmaps::referenced_maps(flecs::world &ecs)
+{
+  static auto weightsQuery = ecs.query<const CompiledDmapWeights>();
+  static auto visualiseQuery = ecs.query<const VisualiseMap>();
+
+  std::unordered_set<flecs::entity_t> referenced;
+  weightsQuery.each([&](const CompiledDmapWeights &cw)
+  {
+    cw.composite.get([&](const DmapComposite &comp)
     {
-      constexpr int radius_research = 2;
-      constexpr int radius_wallcheck = radius_research + 1;
-      for (int i = -radius_research; i <= radius_research; ++i)
-      {
-        for (int j = -radius_research; j <= radius_research; ++j)
-        {
-          int idx = (pos.y + i) * dd.width + pos.x + j;
-          if (idx > 0 && idx < dd.width * dd.height)
-          {
-            dd.researchedTiles[idx] = true;
-          }
-        }
-      }
-      for (int i = -radius_wallcheck; i <= radius_wallcheck; ++i)
-      {
-        for (int j = -radius_wallcheck; j <= radius_wallcheck; ++j)
-        {
-          int idx = (pos.y + i) * dd.width + pos.x + j;
-          if (idx > 0 && idx < dd.width * dd.height && dd.tiles[idx] == dungeon::wall)
-          {
-            dd.researchedTiles[idx] = true;
-          }
-        }
-      }
+      for (const DmapComposite::Layer &layer : comp.layers)
+        referenced.insert(layer.map.id());
     });
-    for (int i = 0; i < map.size(); ++i)
-    {
-      if (!dd.researchedTiles[i])
-        map[i] = 0.f;
-    }
-    process_dmap(map, dd, params);
   });
+  visualiseQuery.each([&](flecs::entity e, const VisualiseMap)
+  {
+    referenced.insert(e.id());
+  });
+  return referenced;
 }
 
-void dmaps::gen_archer_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params)
+void dmaps::update_maps(flecs::world &ecs)
 {
-  static auto dungeonDataQuery = ecs.query<DungeonData>();
-  dungeonDataQuery.each([&](DungeonData &dd)
+  static auto generatorsQuery = ecs.query<DmapGenerator>();
+
+  // previous build must land before its generators are compared against new seeds
+  if (publish_maps(ecs))
+    update_dmap_composites(ecs);
+
+  const std::unordered_set<flecs::entity_t> referenced = referenced_maps(ecs);
+
+  query_dungeon_data(ecs, [&](const DungeonData &dd)
   {
-    init_tiles(map, dd);
-    query_player_position(ecs, [&](const Position &pos, const IsPlayer)
+    // seeds are gathered here as they need ecs, building only needs dungeon and seeds
+    std::vector<MapBuildJob> jobs;
+    generatorsQuery.each([&](flecs::entity e, DmapGenerator &gen)
+    {
+      if (referenced.find(e.id()) == referenced.end())
+        return;
+      Seeds seeds;
+      gen.gather(ecs, dd, seeds);
+      const size_t hash = hash_seeds(seeds);
+      if (gen.built && gen.seedsHash == hash)
+        return;
+      gen.seedsHash = hash;
+      gen.built = true;
+      jobs.push_back({e, gen.build, gen.params, std::move(seeds)});
+    });
+    if (jobs.empty())
+      return;
+    pendingMaps = std::async(std::launch::async, [dd, jobs = std::move(jobs)]()
     {
-      int i, j;
-      for (i = dungeon::rangeDistance, j = 0; i > 0; --i, ++j)
+      BuiltMaps res;
+      std::vector<float> map;
+      for (const MapBuildJob &job : jobs)
       {
-        std::vector<Position> checkPositions
-        {
-          { pos.x + i, pos.y + j },
-          { pos.x - j, pos.y + i },
-          { pos.x - i, pos.y - j },
-          { pos.x + j, pos.y - i }
-        };
-        for (auto checkPosition : checkPositions)
-        {
-          while (!(dungeon::is_tile_walkable(ecs, checkPosition) &&
-                   dungeon::is_tile_reahable(ecs, checkPosition, pos)))
-          {
-            checkPosition = dungeon::get_closer_tile(checkPosition, pos);
-          }
-          map[checkPosition.y * dd.width + checkPosition.x] = 0.f;
-        }
+        job.build(dd, job.seeds, job.params, map);
+        res.emplace_back(job.map, quantize_map(map));
       }
+      return res;
     });
-    process_dmap(map, dd, params);
   });
 }
 
-void dmaps::gen_flee_from_monster_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params)
+bool dmaps::publish_maps(flecs::world &ecs)
 {
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
+  if (!pendingMaps.valid())
+    return false;
+  BuiltMaps maps = pendingMaps.get();
+  ecs.defer([&]
   {
-    map.resize(dd.width * dd.height);
-    for (int i = 0; i < map.size(); ++i)
-      map[i] = invalid_tile_value;
+    for (auto &map : maps)
+      map.first.set(std::move(map.second));
+  });
+  return true;
+}
 
-    
-    bool haveEnemy = false;
-    query_characters_positions(ecs, [&](const Position &pos, const Team &t)
+void dmaps::update_team_fields(flecs::world &ecs)
+{
+  NearestTeamField *field = ecs.get_mut<NearestTeamField>();
+  if (!field)
+    return;
+  query_dungeon_data(ecs, [&](const DungeonData &dd)
+  {
+    const size_t numTiles = dd.width * dd.height;
+    field->width = dd.width;
+    for (NearestTeamField::Layer &layer : field->teams)
+    {
+      layer.dist.assign(numTiles, NearestTeamField::unreachable);
+      layer.member.assign(numTiles, 0);
+    }
+    // all teams are seeded at once, each tile then keeps its own team's front
+    std::queue<std::pair<size_t, size_t>> front;
+    query_characters_positions(ecs, [&](flecs::entity e, const Position &pos, const Team &t)
     {
-      const int posIdx = pos.y * dd.width + pos.x;
-      if (t.team == 1 && dd.researchedTiles[posIdx]) // monster team hardcode
+      if (t.team < 0)
+        return;
+      const size_t team = size_t(t.team);
+      if (team >= field->teams.size())
       {
-        haveEnemy = true;
-        map[posIdx] = 0.f;
+        field->teams.resize(team + 1);
+        field->teams[team].dist.assign(numTiles, NearestTeamField::unreachable);
+        field->teams[team].member.assign(numTiles, 0);
       }
+      NearestTeamField::Layer &layer = field->teams[team];
+      const size_t idx = size_t(pos.y) * dd.width + size_t(pos.x);
+      if (layer.dist[idx] == 0)
+        return;
+      layer.dist[idx] = 0;
+      layer.member[idx] = e.id();
+      front.emplace(team, idx);
     });
-    if (haveEnemy)
+    // uniform step cost, so breadth first order is the Dijkstra order
+    while (!front.empty())
     {
-      process_dmap(map, dd, params);
-      for (float &v : map)
-        if (v < invalid_tile_value)
-          v *= -1.2f;
-    }
-    else
-    {
-      for (int i = 0; i < map.size(); ++i)
-        if (dd.researchedTiles[i])
-          map[i] = 0.0f;
+      const auto [team, idx] = front.front();
+      front.pop();
+      NearestTeamField::Layer &layer = field->teams[team];
+      const size_t x = idx % dd.width;
+      const size_t y = idx / dd.width;
+      auto relax = [&](size_t nx, size_t ny)
+      {
+        if (nx >= dd.width || ny >= dd.height)
+          return;
+        const size_t nidx = ny * dd.width + nx;
+        if (dd.tiles[nidx] != dungeon::floor || layer.dist[nidx] != NearestTeamField::unreachable)
+          return;
+        layer.dist[nidx] = layer.dist[idx] + 1;
+        layer.member[nidx] = layer.member[idx];
+        front.emplace(team, nidx);
+      };
+      relax(x - 1, y);
+      relax(x + 1, y);
+      relax(x, y - 1);
+      relax(x, y + 1);
     }
-          
   });
 }
 
+dmaps::ClosestMember dmaps::closest_enemy(const NearestTeamField &field, const Position &pos, int team)
+{
+  ClosestMember res;
+  const size_t idx = size_t(pos.y) * field.width + size_t(pos.x);
+  for (size_t t = 0; t < field.teams.size(); ++t)
+  {
+    const NearestTeamField::Layer &layer = field.teams[t];
+    if (int(t) == team || idx >= layer.dist.size() || layer.dist[idx] == NearestTeamField::unreachable)
+      continue;
+    if (float(layer.dist[idx]) < res.dist)
+    {
+      res.dist = float(layer.dist[idx]);
+      res.entity = layer.member[idx];
+    }
+  }
+  return res;
+}
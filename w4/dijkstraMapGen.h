@@ -1,18 +1,74 @@
 #pragma once
+#include <unordered_set>
 #include <vector>
 #include <flecs.h>
 #include "ecsTypes.h"
 
+// per team path distance to its closest member and that member, one multi-source pass per turn
+struct NearestTeamField
+{
+  static constexpr uint16_t unreachable = 0xffff;
+
+  struct Layer
+  {
+    std::vector<uint16_t> dist;
+    std::vector<flecs::entity_t> member;
+  };
+  size_t width = 0;
+  std::vector<Layer> teams; // indexed by Team::team
+};
+
 namespace dmaps
 {
-  void gen_player_approach_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params);
-  void gen_player_flee_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params);
-  void gen_hive_pack_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params);
-  void gen_research_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params);
-  void gen_archer_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params);
-  
+  constexpr float invalid_tile_value = DijkstraMapData::invalid_value;
+
+  // tiles which start with zero value, without propagation they are the only valid tiles
+  struct Seeds
+  {
+    std::vector<size_t> tiles;
+    bool propagate = true;
+  };
+
+  using gather_function = void(*)(flecs::world &ecs, const DungeonData &dd, Seeds &seeds);
+  using build_function = void(*)(const DungeonData &dd, const Seeds &seeds, const DmapParams &params, std::vector<float> &map);
+
+  // quantizes generated map, everything at or above invalid_tile_value becomes invalid tile
+  DijkstraMapData quantize_map(const std::vector<float> &map);
+
+  // register named maps, they are generated only while referenced by DmapWeights or VisualiseMap
+  flecs::entity add_player_approach_map(flecs::world &ecs, const char *name, const DmapParams &params);
+  flecs::entity add_player_flee_map(flecs::world &ecs, const char *name, const DmapParams &params);
+  flecs::entity add_hive_pack_map(flecs::world &ecs, const char *name, const DmapParams &params);
+  flecs::entity add_research_map(flecs::world &ecs, const char *name, const DmapParams &params);
+  flecs::entity add_archer_map(flecs::world &ecs, const char *name, const DmapParams &params);
+
   //this is special map only for research mode
-  void gen_flee_from_monster_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params);
-  //void gen_gold_map(flecs::world &ecs, std::vector<float> &map, const DmapParams &params);
+  flecs::entity add_flee_from_monster_map(flecs::world &ecs, const char *name, const DmapParams &params);
+
+  // maps which live entities actually use, either as a layer of DmapWeights or visualised
+  std::unordered_set<flecs::entity_t> referenced_maps(flecs::world &ecs);
+  // gathers seeds of referenced maps and launches background build for those whose seeds changed
+  void update_maps(flecs::world &ecs);
+  // waits for background build if there's one and sets its maps, returns false if nothing was pending
+  bool publish_maps(flecs::world &ecs);
+
+  // rebuilds NearestTeamField singleton from current positions of all teams
+  void update_team_fields(flecs::world &ecs);
+
+  struct ClosestMember
+  {
+    flecs::entity_t entity = 0;
+    float dist = invalid_tile_value;
+  };
+  // closest by path member of any team except given one, entity is 0 if none is reachable
+  ClosestMember closest_enemy(const NearestTeamField &field, const Position &pos, int team);
 };
 
+struct DmapGenerator
+{
+  dmaps::gather_function gather = nullptr;
+  dmaps::build_function build = nullptr;
+  DmapParams params;
+  size_t seedsHash = 0;
+  bool built = false;
+};
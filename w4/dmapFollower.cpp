@@ -1,42 +1,148 @@
 #include "ecsTypes.h"
 #include "dmapFollower.h"
 #include <cmath>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include "dungeonUtils.h"
+#include "dijkstraMapGen.h"
 
+// identical weight sets share one composite, keyed by sorted names and exact bits of weights
+static std::unordered_map<std::string, flecs::entity> composites;
 
+static void append_bits(std::string &key, float val)
+{
+  const uint32_t bits = std::bit_cast<uint32_t>(val);
+  key.append(reinterpret_cast<const char *>(&bits), sizeof(bits));
+}
+
+static DijkstraMapData compose_map(flecs::world &ecs, const DmapComposite &comp)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData>();
+
+  DijkstraMapData res;
+  dungeonDataQuery.each([&](const DungeonData &dd)
+  {
+    std::vector<float> sum(dd.width * dd.height, 0.f);
+    for (const DmapComposite::Layer &layer : comp.layers)
+    {
+      layer.map.get([&](const DijkstraMapData &dmap)
+      {
+        // maps which aren't built yet or have no seeds at all carry no information
+        if (dmap.map.size() != sum.size() ||
+            std::all_of(dmap.map.begin(), dmap.map.end(), [](uint16_t v) { return v == DijkstraMapData::invalid_tile; }))
+          return;
+        for (size_t i = 0; i < sum.size(); ++i)
+        {
+          // tile invalid in any layer is invalid in the sum, adding 1e5 to valid values would only stretch the quantization range
+          const float v = dmap.at(i);
+          if (v >= dmaps::invalid_tile_value || sum[i] >= dmaps::invalid_tile_value)
+            sum[i] = dmaps::invalid_tile_value;
+          else
+            sum[i] += copysignf(powf(fabsf(v * layer.mult), layer.pow), v);
+        }
+      });
+    }
+    res = dmaps::quantize_map(sum);
+  });
+  return res;
+}
+
+static flecs::entity compile_dmap_weights(flecs::world &ecs, const DmapWeights &wt)
+{
+  std::vector<std::pair<std::string, DmapWeights::WtData>> sorted(wt.weights.begin(), wt.weights.end());
+  std::sort(sorted.begin(), sorted.end(), [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+  std::string key;
+  for (const auto &pair : sorted)
+  {
+    key += pair.first;
+    key += '\0';
+    append_bits(key, pair.second.mult);
+    append_bits(key, pair.second.pow);
+  }
+
+  auto itf = composites.find(key);
+  if (itf != composites.end() && ecs.is_valid(itf->second))
+    return itf->second;
+
+  DmapComposite composite;
+  for (const auto &pair : sorted)
+    composite.layers.push_back({ecs.entity(pair.first.c_str()), pair.second.mult, pair.second.pow});
+  // maps it's made of may be built already and won't be republished, so it's composed right away
+  flecs::entity res = ecs.entity()
+    .set(composite)
+    .set(compose_map(ecs, composite));
+  composites[key] = res;
+  return res;
+}
+
+// composites no follower points to anymore would still be recomputed every time maps change
+static void collect_unused_composites(flecs::world &ecs)
+{
+  static auto weightsQuery = ecs.query<const CompiledDmapWeights>();
+
+  std::unordered_set<flecs::entity_t> referenced;
+  weightsQuery.each([&](const CompiledDmapWeights &cw)
+  {
+    referenced.insert(cw.composite.id());
+  });
+  for (auto it = composites.begin(); it != composites.end();)
+  {
+    if (referenced.find(it->second.id()) != referenced.end())
+    {
+      ++it;
+      continue;
+    }
+    if (ecs.is_valid(it->second))
+      it->second.destruct();
+    it = composites.erase(it);
+  }
+}
+
+void register_dmap_followers(flecs::world &ecs)
+{
+  ecs.observer<const DmapWeights>()
+    .event(flecs::OnSet)
+    .each([&](flecs::entity e, const DmapWeights &wt)
+    {
+      e.set(CompiledDmapWeights{compile_dmap_weights(ecs, wt)});
+    });
+}
+
+void update_dmap_composites(flecs::world &ecs)
+{
+  static auto compositesQuery = ecs.query<const DmapComposite, DijkstraMapData>();
+
+  collect_unused_composites(ecs);
+  compositesQuery.each([&](const DmapComposite &comp, DijkstraMapData &res)
+  {
+    res = compose_map(ecs, comp);
+  });
+}
 
 void process_dmap_followers(flecs::world &ecs)
 {
-  static auto processDmapFollowers = ecs.query<const Position, Action, const DmapWeights>();
+  static auto processDmapFollowers = ecs.query<const Position, Action, const CompiledDmapWeights>();
   static auto processDmapArcher = ecs.query<const Position, Action, const DmapWeights, const Team, const IsArcher>();
   static auto dungeonDataQuery = ecs.query<const DungeonData>();
-  static auto findRangeEnemy = ecs.query<const MovePos, const Hitpoints, const Team>();
 
-  auto get_dmap_at = [&](const DijkstraMapData &dmap, const DungeonData &dd, size_t x, size_t y, float mult, float pow)
-  {
-    const float v = dmap.map[y * dd.width + x];
-    if (v < 1e5f)
-      return copysignf(powf(abs(v * mult), pow), v);
-    return v;
-  };
   dungeonDataQuery.each([&](const DungeonData &dd)
   {
-    processDmapFollowers.each([&](const Position &pos, Action &act, const DmapWeights &wt)
+    processDmapFollowers.each([&](const Position &pos, Action &act, const CompiledDmapWeights &cw)
     {
+      const DijkstraMapData *dmap = cw.composite.get<DijkstraMapData>();
+      if (!dmap || dmap->map.empty())
+        return;
+      auto get_dmap_at = [&](int x, int y) { return dmap->at(size_t(y) * dd.width + size_t(x)); };
       float moveWeights[EA_MOVE_END];
-      for (size_t i = 0; i < EA_MOVE_END; ++i)
-        moveWeights[i] = 0.f;
-      for (const auto &pair : wt.weights)
-      {
-        ecs.entity(pair.first.c_str()).get([&](const DijkstraMapData &dmap)
-        {
-          moveWeights[EA_NOP]         += get_dmap_at(dmap, dd, pos.x+0, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_LEFT]   += get_dmap_at(dmap, dd, pos.x-1, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_RIGHT]  += get_dmap_at(dmap, dd, pos.x+1, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_UP]     += get_dmap_at(dmap, dd, pos.x+0, pos.y-1, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_DOWN]   += get_dmap_at(dmap, dd, pos.x+0, pos.y+1, pair.second.mult, pair.second.pow);
-        });
-      }
+      moveWeights[EA_NOP]         = get_dmap_at(pos.x+0, pos.y+0);
+      moveWeights[EA_MOVE_LEFT]   = get_dmap_at(pos.x-1, pos.y+0);
+      moveWeights[EA_MOVE_RIGHT]  = get_dmap_at(pos.x+1, pos.y+0);
+      moveWeights[EA_MOVE_UP]     = get_dmap_at(pos.x+0, pos.y-1);
+      moveWeights[EA_MOVE_DOWN]   = get_dmap_at(pos.x+0, pos.y+1);
       float minWt = moveWeights[EA_NOP];
       for (size_t i = 0; i < EA_MOVE_END; ++i)
         if (moveWeights[i] < minWt)
@@ -52,4 +158,3 @@ void process_dmap_followers(flecs::world &ecs)
     });
   });
 }
-
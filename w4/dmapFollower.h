@@ -1,5 +1,25 @@
 #pragma once
+#include <vector>
 #include <flecs.h>
 
-void process_dmap_followers(flecs::world &ecs);
+// DmapWeights compiled to resolved map handles, one per distinct weight set
+struct DmapComposite
+{
+  struct Layer
+  {
+    flecs::entity map;
+    float mult = 1.f;
+    float pow = 1.f;
+  };
+  std::vector<Layer> layers;
+};
+
+// set on every entity with DmapWeights, points to the shared composite
+struct CompiledDmapWeights
+{
+  flecs::entity composite;
+};
 
+void register_dmap_followers(flecs::world &ecs);
+void update_dmap_composites(flecs::world &ecs);
+void process_dmap_followers(flecs::world &ecs);
@@ -0,0 +1,180 @@
+#include "dstarLite.h"
+#include "dungeonUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+constexpr float inf = std::numeric_limits<float>::infinity();
+
+static float heuristic(const DStarLite &ds, size_t from, size_t to)
+{
+  const int dx = int(from % ds.width) - int(to % ds.width);
+  const int dy = int(from / ds.width) - int(to / ds.width);
+  return float(std::abs(dx) + std::abs(dy));
+}
+
+static bool is_floor(const DungeonData &dd, size_t idx)
+{
+  return dd.tiles[idx] == dungeon::floor;
+}
+
+template<typename Callable>
+static void for_neighbours(const DStarLite &ds, size_t idx, Callable c)
+{
+  const size_t x = idx % ds.width;
+  const size_t y = idx / ds.width;
+  if (x > 0)
+    c(idx - 1);
+  if (x + 1 < ds.width)
+    c(idx + 1);
+  if (y > 0)
+    c(idx - ds.width);
+  if (y + 1 < ds.height)
+    c(idx + ds.width);
+}
+
+static DStarLite::Key calc_key(const DStarLite &ds, size_t idx)
+{
+  const float m = std::min(ds.g[idx], ds.rhs[idx]);
+  return {m + heuristic(ds, idx, ds.start) + ds.km, m};
+}
+
+static void dequeue(DStarLite &ds, size_t idx)
+{
+  if (!ds.queued[idx])
+    return;
+  ds.open.erase({ds.keys[idx].first, ds.keys[idx].second, idx});
+  ds.queued[idx] = 0;
+}
+
+static void update_state(DStarLite &ds, size_t idx)
+{
+  dequeue(ds, idx);
+  if (ds.g[idx] == ds.rhs[idx])
+    return;
+  ds.keys[idx] = calc_key(ds, idx);
+  ds.open.emplace(ds.keys[idx].first, ds.keys[idx].second, idx);
+  ds.queued[idx] = 1;
+}
+
+// best predecessor of a tile, unit cost between neighbouring floor tiles
+static void recompute_rhs(DStarLite &ds, const DungeonData &dd, size_t idx)
+{
+  ds.rhs[idx] = inf;
+  ds.parent[idx] = DStarLite::no_tile;
+  if (!is_floor(dd, idx))
+    return;
+  for_neighbours(ds, idx, [&](size_t nidx)
+  {
+    if (is_floor(dd, nidx) && ds.g[nidx] + 1.f < ds.rhs[idx])
+    {
+      ds.rhs[idx] = ds.g[nidx] + 1.f;
+      ds.parent[idx] = nidx;
+    }
+  });
+}
+
+static void reset(DStarLite &ds, const DungeonData &dd, size_t agent, size_t target)
+{
+  const size_t numTiles = dd.width * dd.height;
+  ds.width = dd.width;
+  ds.height = dd.height;
+  ds.start = agent;
+  ds.goal = target;
+  ds.km = 0.f;
+  ds.g.assign(numTiles, inf);
+  ds.rhs.assign(numTiles, inf);
+  ds.parent.assign(numTiles, DStarLite::no_tile);
+  ds.keys.assign(numTiles, {inf, inf});
+  ds.queued.assign(numTiles, 0);
+  ds.open.clear();
+  ds.rhs[target] = 0.f;
+  update_state(ds, target);
+}
+
+static bool key_less(const DStarLite::Key &lhs, const DStarLite::Key &rhs)
+{
+  return lhs.first < rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+}
+
+static void compute_path(DStarLite &ds, const DungeonData &dd)
+{
+  ds.lastExpansions = 0;
+  while (!ds.open.empty())
+  {
+    const auto [k1, k2, u] = *ds.open.begin();
+    const DStarLite::Key kOld{k1, k2};
+    if (!key_less(kOld, calc_key(ds, ds.start)) && ds.rhs[ds.start] == ds.g[ds.start])
+      break;
+    ++ds.lastExpansions;
+    const DStarLite::Key kNew = calc_key(ds, u);
+    if (key_less(kOld, kNew))
+    {
+      update_state(ds, u);
+      continue;
+    }
+    if (ds.g[u] > ds.rhs[u])
+    {
+      // locally overconsistent, value settles and improves neighbours
+      ds.g[u] = ds.rhs[u];
+      dequeue(ds, u);
+      for_neighbours(ds, u, [&](size_t s)
+      {
+        if (s != ds.goal && is_floor(dd, s) && ds.rhs[s] > ds.g[u] + 1.f)
+        {
+          ds.parent[s] = u;
+          ds.rhs[s] = ds.g[u] + 1.f;
+          update_state(ds, s);
+        }
+      });
+    }
+    else
+    {
+      // locally underconsistent, children lose their parent and look for another one
+      ds.g[u] = inf;
+      for_neighbours(ds, u, [&](size_t s)
+      {
+        if (s != ds.goal && ds.parent[s] == u)
+        {
+          recompute_rhs(ds, dd, s);
+          update_state(ds, s);
+        }
+      });
+      update_state(ds, u);
+    }
+  }
+}
+
+// the target moved, new root is seeded and the old one turns into an ordinary tile,
+// only the part of the tree whose distances changed gets repaired
+static void move_goal(DStarLite &ds, const DungeonData &dd, size_t target)
+{
+  const size_t oldGoal = ds.goal;
+  ds.goal = target;
+  ds.parent[target] = DStarLite::no_tile;
+  ds.rhs[target] = 0.f;
+  update_state(ds, target);
+  recompute_rhs(ds, dd, oldGoal);
+  update_state(ds, oldGoal);
+}
+
+size_t dstar::next_tile(DStarLite &ds, const DungeonData &dd, size_t agent, size_t target)
+{
+  if (agent == target)
+    return DStarLite::no_tile;
+  if (ds.width != dd.width || ds.height != dd.height || ds.goal == DStarLite::no_tile)
+    reset(ds, dd, agent, target);
+  if (ds.start != agent)
+  {
+    // keys stay lower bounds, heuristic to the new start differs by at most the agent shift
+    ds.km += heuristic(ds, ds.start, agent);
+    ds.start = agent;
+  }
+  if (ds.goal != target)
+    move_goal(ds, dd, target);
+  compute_path(ds, dd);
+  if (ds.rhs[agent] == inf)
+    return DStarLite::no_tile;
+  // tree points towards the root, parent of the agent is the next step
+  return ds.parent[agent];
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <tuple>
+#include <vector>
+#include "ecsTypes.h"
+
+// D* Lite over floor tiles, search tree is rooted at the chased target and kept between turns,
+// agent moves only grow km, target moves reseed the root and repair the affected part of the tree
+struct DStarLite
+{
+  static constexpr size_t no_tile = size_t(-1);
+
+  using Key = std::pair<float, float>;
+
+  size_t width = 0;
+  size_t height = 0;
+  size_t start = no_tile; // agent, the search stops once it is consistent
+  size_t goal = no_tile; // target, root of the search tree
+  float km = 0.f;
+  std::vector<float> g;
+  std::vector<float> rhs;
+  std::vector<size_t> parent;
+  std::vector<Key> keys; // key each tile is queued with
+  std::vector<uint8_t> queued;
+  std::set<std::tuple<float, float, size_t>> open;
+
+  size_t lastExpansions = 0; // tiles expanded by the last repair
+};
+
+// per agent search, used by chasing behaviours
+using ChasePath = DStarLite;
+
+namespace dstar
+{
+  // moves start to agent and root to target, repairs the tree and returns next tile towards target,
+  // no_tile if target is unreachable or already reached
+  size_t next_tile(DStarLite &ds, const DungeonData &dd, size_t agent, size_t target);
+};
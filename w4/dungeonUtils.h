@@ -10,6 +10,4 @@ namespace dungeon
 
   Position find_walkable_tile(flecs::world &ecs);
   bool is_tile_walkable(flecs::world &ecs, Position pos);
-  bool is_tile_reahable(flecs::world &ecs, Position from, Position to);
-  Position get_closer_tile(Position from, Position to);
 };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -150,14 +151,22 @@ struct BackgroundTile {};
 struct DungeonData
 {
   std::vector<char> tiles; // for pathfinding
-  std::vector<bool> researchedTiles;
   size_t width;
   size_t height;
+  uint32_t revision; // whoever changes tiles bumps it, caches built over tiles compare against it
 };
 
+// 16-bit fixed point with per-map range, value = offset + q * scale
 struct DijkstraMapData
 {
-  std::vector<float> map;
+  static constexpr uint16_t invalid_tile = 0xffff;
+  static constexpr float invalid_value = 1e5f;
+
+  std::vector<uint16_t> map;
+  float offset = 0.f;
+  float scale = 1.f;
+
+  float at(size_t idx) const { return map[idx] == invalid_tile ? invalid_value : offset + float(map[idx]) * scale; }
 };
 
 struct VisualiseMap {};
@@ -0,0 +1,100 @@
+#include "exploration.h"
+#include <algorithm>
+#include <bit>
+
+static std::vector<uint64_t> &team_bits(ExplorationMap &em, int team)
+{
+  if (size_t(team) >= em.teams.size())
+    em.teams.resize(size_t(team) + 1, std::vector<uint64_t>(em.stride * em.height, 0));
+  return em.teams[size_t(team)];
+}
+
+// bits [from, to] of a single word
+static uint64_t word_mask(size_t from, size_t to)
+{
+  const uint64_t high = to >= 63 ? ~uint64_t(0) : (uint64_t(1) << (to + 1)) - 1;
+  return high & ~((uint64_t(1) << from) - 1);
+}
+
+ExplorationMap exploration::create(size_t w, size_t h, size_t num_teams)
+{
+  ExplorationMap res;
+  res.width = w;
+  res.height = h;
+  res.stride = (w + 63) / 64;
+  res.teams.resize(num_teams, std::vector<uint64_t>(res.stride * h, 0));
+  return res;
+}
+
+void exploration::reveal_all(ExplorationMap &em, int team)
+{
+  std::vector<uint64_t> &bits = team_bits(em, team);
+  for (size_t y = 0; y < em.height; ++y)
+    for (size_t w = 0; w < em.stride; ++w)
+      bits[y * em.stride + w] = word_mask(0, std::min(em.width - w * 64, size_t(64)) - 1);
+}
+
+size_t exploration::reveal(ExplorationMap &em, int team, const std::vector<size_t> &tiles)
+{
+  std::vector<uint64_t> &bits = team_bits(em, team);
+  size_t revealed = 0;
+  for (size_t idx : tiles)
+  {
+    const size_t x = idx % em.width;
+    const size_t y = idx / em.width;
+    uint64_t &word = bits[y * em.stride + (x >> 6)];
+    const uint64_t bit = uint64_t(1) << (x & 63);
+    revealed += (word & bit) == 0;
+    word |= bit;
+  }
+  return revealed;
+}
+
+bool exploration::any_explored(const ExplorationMap &em, int team, int min_x, int min_y, int max_x, int max_y)
+{
+  if (size_t(team) >= em.teams.size())
+    return false;
+  const size_t fromX = size_t(std::max(min_x, 0));
+  const size_t fromY = size_t(std::max(min_y, 0));
+  const size_t toX = std::min(size_t(std::max(max_x, 0)), em.width - 1);
+  const size_t toY = std::min(size_t(std::max(max_y, 0)), em.height - 1);
+  if (max_x < 0 || max_y < 0 || fromX > toX || fromY > toY)
+    return false;
+  const std::vector<uint64_t> &bits = em.teams[size_t(team)];
+  for (size_t y = fromY; y <= toY; ++y)
+    for (size_t w = fromX >> 6; w <= toX >> 6; ++w)
+    {
+      const size_t from = w == (fromX >> 6) ? fromX & 63 : 0;
+      const size_t to = w == (toX >> 6) ? toX & 63 : 63;
+      if (bits[y * em.stride + w] & word_mask(from, to))
+        return true;
+    }
+  return false;
+}
+
+size_t exploration::count_explored(const ExplorationMap &em, int team)
+{
+  if (size_t(team) >= em.teams.size())
+    return 0;
+  size_t res = 0;
+  for (uint64_t word : em.teams[size_t(team)])
+    res += size_t(std::popcount(word));
+  return res;
+}
+
+void exploration::collect_tiles(const ExplorationMap &em, int team, bool explored, std::vector<size_t> &tiles)
+{
+  const bool hasTeam = size_t(team) < em.teams.size();
+  for (size_t y = 0; y < em.height; ++y)
+    for (size_t w = 0; w < em.stride; ++w)
+    {
+      const uint64_t valid = word_mask(0, std::min(em.width - w * 64, size_t(64)) - 1);
+      const uint64_t bits = hasTeam ? em.teams[size_t(team)][y * em.stride + w] : 0;
+      uint64_t word = (explored ? bits : ~bits) & valid;
+      while (word)
+      {
+        tiles.push_back(y * em.width + w * 64 + size_t(std::countr_zero(word)));
+        word &= word - 1;
+      }
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// explored tiles packed into words, one bitset per team, rows are padded to whole words
+struct ExplorationMap
+{
+  size_t width = 0;
+  size_t height = 0;
+  size_t stride = 0; // words per row
+  std::vector<std::vector<uint64_t>> teams;
+
+  bool is_explored(int team, size_t x, size_t y) const
+  {
+    return (teams[size_t(team)][y * stride + (x >> 6)] >> (x & 63)) & 1;
+  }
+};
+
+namespace exploration
+{
+  ExplorationMap create(size_t w, size_t h, size_t num_teams);
+
+  void reveal_all(ExplorationMap &em, int team);
+  // tiles are y * width + x indices, returns how many of them were not explored before
+  size_t reveal(ExplorationMap &em, int team, const std::vector<size_t> &tiles);
+
+  // rectangle bounds are inclusive and clamped to the map
+  bool any_explored(const ExplorationMap &em, int team, int min_x, int min_y, int max_x, int max_y);
+  size_t count_explored(const ExplorationMap &em, int team);
+  void collect_tiles(const ExplorationMap &em, int team, bool explored, std::vector<size_t> &tiles);
+};
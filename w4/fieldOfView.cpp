@@ -0,0 +1,132 @@
+#include "fieldOfView.h"
+#include "dungeonUtils.h"
+#include "math.h"
+#include <algorithm>
+
+static uint64_t make_key(size_t origin_idx, int radius)
+{
+  return (origin_idx << 8) | uint64_t(radius & 0xff);
+}
+
+static bool is_opaque(const DungeonData &dd, int x, int y)
+{
+  if (x < 0 || y < 0 || x >= int(dd.width) || y >= int(dd.height))
+    return true;
+  return dd.tiles[size_t(y) * dd.width + size_t(x)] == dungeon::wall;
+}
+
+// one octant of recursive shadowcasting, xx/xy/yx/yy transform octant coords to map coords
+static void cast_light(const DungeonData &dd, int cx, int cy, int row, float start, float end, int radius,
+                       int xx, int xy, int yx, int yy, std::vector<size_t> &res)
+{
+  if (start < end)
+    return;
+  float newStart = 0.f;
+  for (int j = row; j <= radius; ++j)
+  {
+    int dx = -j - 1;
+    const int dy = -j;
+    bool blocked = false;
+    while (dx <= 0)
+    {
+      dx += 1;
+      const int x = cx + dx * xx + dy * xy;
+      const int y = cy + dx * yx + dy * yy;
+      const float leftSlope = (float(dx) - 0.5f) / (float(dy) + 0.5f);
+      const float rightSlope = (float(dx) + 0.5f) / (float(dy) - 0.5f);
+      if (start < rightSlope)
+        continue;
+      if (end > leftSlope)
+        break;
+      if (dx * dx + dy * dy <= radius * radius && x >= 0 && y >= 0 && x < int(dd.width) && y < int(dd.height))
+        res.push_back(size_t(y) * dd.width + size_t(x));
+      const bool opaque = is_opaque(dd, x, y);
+      if (blocked)
+      {
+        if (opaque)
+        {
+          newStart = rightSlope;
+          continue;
+        }
+        blocked = false;
+        start = newStart;
+      }
+      else if (opaque && j < radius)
+      {
+        blocked = true;
+        cast_light(dd, cx, cy, j + 1, start, leftSlope, radius, xx, xy, yx, yy, res);
+        newStart = rightSlope;
+      }
+    }
+    if (blocked)
+      break;
+  }
+}
+
+const std::vector<size_t> &fov::visible_tiles(FovCache &cache, const DungeonData &dd, Position origin, int radius)
+{
+  if (cache.revision != dd.revision)
+  {
+    cache.visible.clear();
+    cache.recency.clear();
+    cache.revision = dd.revision;
+  }
+  const size_t originIdx = size_t(origin.y) * dd.width + size_t(origin.x);
+  const uint64_t key = make_key(originIdx, radius);
+  auto itf = cache.visible.find(key);
+  if (itf != cache.visible.end())
+  {
+    cache.recency.splice(cache.recency.begin(), cache.recency, itf->second.use);
+    return itf->second.tiles;
+  }
+
+  static constexpr int octants[4][8] =
+  {
+    {1,  0,  0, -1, -1,  0,  0,  1},
+    {0,  1, -1,  0,  0, -1,  1,  0},
+    {0,  1,  1,  0,  0, -1, -1,  0},
+    {1,  0,  0,  1, -1,  0,  0, -1}
+  };
+  std::vector<size_t> res = {originIdx};
+  for (size_t oct = 0; oct < 8; ++oct)
+    cast_light(dd, origin.x, origin.y, 1, 1.f, 0.f, radius,
+               octants[0][oct], octants[1][oct], octants[2][oct], octants[3][oct], res);
+  std::sort(res.begin(), res.end());
+  res.erase(std::unique(res.begin(), res.end()), res.end());
+  if (cache.visible.size() >= cache.maxEntries && !cache.recency.empty())
+  {
+    cache.visible.erase(cache.recency.back());
+    cache.recency.pop_back();
+  }
+  cache.recency.push_front(key);
+  return cache.visible.emplace(key, FovCache::Entry{std::move(res), cache.recency.begin()}).first->second.tiles;
+}
+
+bool fov::has_los(FovCache &cache, const DungeonData &dd, Position from, Position to, int radius)
+{
+  if (to.x < 0 || to.y < 0 || to.x >= int(dd.width) || to.y >= int(dd.height))
+    return false;
+  const std::vector<size_t> &visible = visible_tiles(cache, dd, from, radius);
+  return std::binary_search(visible.begin(), visible.end(), size_t(to.y) * dd.width + size_t(to.x));
+}
+
+void fov::has_los_batch(FovCache &cache, const DungeonData &dd, const std::vector<std::pair<Position, Position>> &pairs,
+                        int radius, std::vector<bool> &res)
+{
+  res.resize(pairs.size());
+  // pairs usually come grouped by origin, so keep last visibility set around
+  const std::vector<size_t> *visible = nullptr;
+  Position lastOrigin{-1, -1};
+  for (size_t i = 0; i < pairs.size(); ++i)
+  {
+    const Position &from = pairs[i].first;
+    const Position &to = pairs[i].second;
+    if (!visible || from != lastOrigin)
+    {
+      visible = &visible_tiles(cache, dd, from, radius);
+      lastOrigin = from;
+    }
+    res[i] = to.x >= 0 && to.y >= 0 && to.x < int(dd.width) && to.y < int(dd.height) &&
+             std::binary_search(visible->begin(), visible->end(), size_t(to.y) * dd.width + size_t(to.x));
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ecsTypes.h"
+
+// visibility sets per (origin tile, radius), lives next to DungeonData
+// whole cache is dropped once DungeonData::revision moves on, least recently used entry is evicted when full
+struct FovCache
+{
+  struct Entry
+  {
+    std::vector<size_t> tiles;
+    std::list<uint64_t>::iterator use;
+  };
+  size_t maxEntries = 4096;
+  uint32_t revision = 0; // dungeon revision entries were cast for
+  std::list<uint64_t> recency; // most recently used first
+  std::unordered_map<uint64_t, Entry> visible;
+};
+
+namespace fov
+{
+  // sorted indices of tiles visible from origin (recursive shadowcasting), walls which block view included
+  const std::vector<size_t> &visible_tiles(FovCache &cache, const DungeonData &dd, Position origin, int radius);
+
+  bool has_los(FovCache &cache, const DungeonData &dd, Position from, Position to, int radius);
+  // res[i] tells whether pairs[i].second is visible from pairs[i].first
+  void has_los_batch(FovCache &cache, const DungeonData &dd, const std::vector<std::pair<Position, Position>> &pairs,
+                     int radius, std::vector<bool> &res);
+};
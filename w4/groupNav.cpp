@@ -0,0 +1,210 @@
+#include "groupNav.h"
+#include "dungeonUtils.h"
+#include "aiUtils.h"
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+// column of pairs behind the leader
+static void assign_slot(PackMember &member)
+{
+  member.trail = int(member.slot + 1) / 2;
+  member.side = member.slot == 0 ? 0 : member.slot % 2 ? -1 : 1;
+}
+
+void group_nav::join(flecs::entity member, const char *pack_name)
+{
+  flecs::entity pack = member.world().entity(pack_name);
+  if (!pack.has<PackNavigation>())
+    pack.set(PackNavigation{});
+  PackNavigation *nav = pack.get_mut<PackNavigation>();
+  PackMember pm{pack, nav->numSlots++};
+  assign_slot(pm);
+  member.set(pm);
+}
+
+// bfs from tile to closest tile passing is_goal, optionally limited by radius around start, empty if unreachable
+template<typename IsGoal>
+static std::vector<size_t> find_corridor(const DungeonData &dd, size_t from, IsGoal is_goal,
+                                         const std::unordered_set<size_t> &blocked, int radius)
+{
+  std::unordered_map<size_t, size_t> prev;
+  std::queue<size_t> openList;
+  prev[from] = from;
+  openList.push(from);
+  const int fromX = int(from % dd.width);
+  const int fromY = int(from / dd.width);
+  while (!openList.empty())
+  {
+    const size_t idx = openList.front();
+    openList.pop();
+    if (is_goal(idx))
+    {
+      std::vector<size_t> res;
+      for (size_t cur = idx; cur != from; cur = prev[cur])
+        res.push_back(cur);
+      res.push_back(from);
+      std::reverse(res.begin(), res.end());
+      return res;
+    }
+    const int x = int(idx % dd.width);
+    const int y = int(idx / dd.width);
+    auto visit = [&](int nx, int ny)
+    {
+      if (nx < 0 || ny < 0 || nx >= int(dd.width) || ny >= int(dd.height))
+        return;
+      if (radius > 0 && (abs(nx - fromX) > radius || abs(ny - fromY) > radius))
+        return;
+      const size_t nidx = size_t(ny) * dd.width + size_t(nx);
+      if (dd.tiles[nidx] != dungeon::floor || prev.count(nidx) || (blocked.count(nidx) && !is_goal(nidx)))
+        return;
+      prev[nidx] = idx;
+      openList.push(nidx);
+    };
+    visit(x - 1, y);
+    visit(x + 1, y);
+    visit(x, y - 1);
+    visit(x, y + 1);
+  }
+  return {};
+}
+
+static Position tile_pos(const DungeonData &dd, size_t idx)
+{
+  return Position{int(idx % dd.width), int(idx / dd.width)};
+}
+
+void group_nav::process_packs(flecs::world &ecs)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData>();
+  static auto membersQuery = ecs.query<const Position, Action, PackMember>();
+  static auto hiveQuery = ecs.query<const Position, const Hive>();
+  static auto charactersQuery = ecs.query<const Position, const Hitpoints>();
+
+  dungeonDataQuery.each([&](const DungeonData &dd)
+  {
+    std::unordered_set<size_t> hives;
+    hiveQuery.each([&](const Position &pos, const Hive &)
+    {
+      hives.insert(size_t(pos.y) * dd.width + size_t(pos.x));
+    });
+    std::unordered_set<size_t> occupied;
+    charactersQuery.each([&](const Position &pos, const Hitpoints &)
+    {
+      occupied.insert(size_t(pos.y) * dd.width + size_t(pos.x));
+    });
+
+    struct MemberRef
+    {
+      const Position *pos;
+      Action *act;
+      PackMember *pm;
+    };
+    std::unordered_map<flecs::entity_t, std::vector<MemberRef>> packs;
+    membersQuery.each([&](const Position &pos, Action &act, PackMember &pm)
+    {
+      packs[pm.pack.id()].push_back({&pos, &act, &pm});
+    });
+
+    for (auto &[packId, members] : packs)
+    {
+      std::sort(members.begin(), members.end(), [](const MemberRef &lhs, const MemberRef &rhs)
+      {
+        return lhs.pm->slot < rhs.pm->slot;
+      });
+      PackNavigation *nav = members.front().pm->pack.get_mut<PackNavigation>();
+      if (!nav)
+        continue;
+      // dead members leave gaps, the rest move up so the formation stays packed
+      for (size_t i = 0; i < members.size(); ++i)
+        if (members[i].pm->slot != i)
+        {
+          members[i].pm->slot = i;
+          assign_slot(*members[i].pm);
+        }
+      nav->numSlots = members.size();
+      // leader is whoever has the lowest slot left, only the leader searches, and only when it left the corridor
+      const MemberRef &leader = members.front();
+      const size_t leaderTile = size_t(leader.pos->y) * dd.width + size_t(leader.pos->x);
+      if (nav->leaderStep + 1 < nav->corridor.size() && nav->corridor[nav->leaderStep + 1] == leaderTile)
+        ++nav->leaderStep;
+      const bool onCorridor = nav->leaderStep < nav->corridor.size() && nav->corridor[nav->leaderStep] == leaderTile;
+      const bool goalValid = !nav->corridor.empty() && hives.count(nav->corridor.back());
+      if (!onCorridor || !goalValid)
+      {
+        nav->corridor = find_corridor(dd, leaderTile, [&](size_t idx) { return hives.count(idx) > 0; }, {}, 0);
+        nav->leaderStep = 0;
+      }
+      if (nav->corridor.empty())
+        continue;
+
+      std::unordered_map<size_t, int> corridorSteps;
+      for (size_t i = 0; i < nav->corridor.size(); ++i)
+        corridorSteps.emplace(nav->corridor[i], int(i));
+
+      // the goal tile itself is taken by the hive
+      const int lastStep = std::max(int(nav->corridor.size()) - 2, 0);
+      for (const MemberRef &member : members)
+      {
+        // slots are measured from leader's place on the corridor
+        const int trail = &member == &leader ? -1 : member.pm->trail;
+        const int step = std::clamp(int(nav->leaderStep) - trail, 0, lastStep);
+        const size_t corridorTile = nav->corridor[size_t(step)];
+        Position target = tile_pos(dd, corridorTile);
+        if (member.pm->side != 0 && size_t(step) + 1 < nav->corridor.size())
+        {
+          // sideways is perpendicular to the corridor direction at slot
+          const Position dir = tile_pos(dd, nav->corridor[size_t(step) + 1]) - target;
+          const Position shifted{target.x - dir.y * member.pm->side, target.y + dir.x * member.pm->side};
+          if (shifted.x >= 0 && shifted.y >= 0 && shifted.x < int(dd.width) && shifted.y < int(dd.height) &&
+              dd.tiles[size_t(shifted.y) * dd.width + size_t(shifted.x)] == dungeon::floor)
+            target = shifted;
+        }
+        if (*member.pos == target)
+        {
+          member.act->action = EA_NOP;
+          continue;
+        }
+        // members on the corridor walk along it to their step, the rest head straight for the slot
+        const size_t memberTile = size_t(member.pos->y) * dd.width + size_t(member.pos->x);
+        const size_t targetTile = size_t(target.y) * dd.width + size_t(target.x);
+        auto onCorridor = corridorSteps.find(memberTile);
+        if (onCorridor != corridorSteps.end())
+          member.pm->rejoining = false;
+        const int stepsLeft = onCorridor != corridorSteps.end() ? abs(onCorridor->second - step) : int(nav->corridor.size());
+        if (!member.pm->rejoining)
+        {
+          Position next = *member.pos;
+          if (onCorridor == corridorSteps.end() || onCorridor->second == step)
+          {
+            const int move = move_towards(*member.pos, target);
+            next.x += move == EA_MOVE_LEFT ? -1 : move == EA_MOVE_RIGHT ? 1 : 0;
+            next.y += move == EA_MOVE_UP ? -1 : move == EA_MOVE_DOWN ? 1 : 0;
+          }
+          else
+            next = tile_pos(dd, nav->corridor[size_t(onCorridor->second + (onCorridor->second < step ? 1 : -1))]);
+          const size_t nextTile = size_t(next.y) * dd.width + size_t(next.x);
+          if (dd.tiles[nextTile] == dungeon::floor && !occupied.count(nextTile))
+          {
+            member.act->action = move_towards(*member.pos, next);
+            continue;
+          }
+          member.pm->rejoining = onCorridor == corridorSteps.end();
+        }
+        // blocked, repair locally towards the slot or a corridor tile closer to it
+        constexpr int repair_radius = 4;
+        auto is_goal = [&](size_t idx)
+        {
+          auto itf = corridorSteps.find(idx);
+          return (idx == targetTile && !member.pm->rejoining) ||
+                 (itf != corridorSteps.end() && abs(itf->second - step) < stepsLeft);
+        };
+        const std::vector<size_t> detour = find_corridor(dd, memberTile, is_goal, occupied, repair_radius);
+        member.act->action = detour.size() > 1 ? move_towards(*member.pos, tile_pos(dd, detour[1])) : EA_NOP;
+        if (detour.empty())
+          member.pm->rejoining = false; // corridor is out of reach, try heading for the slot again
+      }
+    }
+  });
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <flecs.h>
+#include "ecsTypes.h"
+
+// pack shares one leader search to the closest hive, the rest follow formation slots along the leader's corridor
+struct PackNavigation
+{
+  std::vector<size_t> corridor; // tiles from leader position at search time to the goal
+  size_t leaderStep = 0; // index of leader's tile in corridor
+  size_t numSlots = 0;
+};
+
+// slot trails the leader by some corridor steps and is shifted sideways from it
+struct PackMember
+{
+  flecs::entity pack;
+  size_t slot = 0; // 0 is the leader
+  int trail = 0;
+  int side = 0;
+  bool rejoining = false; // got blocked off the corridor, walks back onto it before heading for the slot again
+};
+
+namespace group_nav
+{
+  // adds entity into named pack, pack entity is created on first join
+  void join(flecs::entity member, const char *pack_name);
+  // plans actions of all pack members, must be called during npc planning
+  void process_packs(flecs::world &ecs);
+};
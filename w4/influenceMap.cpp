@@ -0,0 +1,173 @@
+#include "influenceMap.h"
+#include "dijkstraMapGen.h"
+#include "dungeonUtils.h"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+InfluenceMap influence::create(size_t w, size_t h, size_t num_teams)
+{
+  InfluenceMap res;
+  res.width = w;
+  res.height = h;
+  res.teams.resize(num_teams, std::vector<float>(w * h, 0.f));
+  res.past.resize(num_teams, std::vector<float>(w * h, 0.f));
+  res.unpublished.resize(num_teams, 1);
+  res.visited.resize(w * h, 0);
+  return res;
+}
+
+static void ensure_team(InfluenceMap &im, size_t team)
+{
+  if (team < im.teams.size())
+    return;
+  im.teams.resize(team + 1, std::vector<float>(im.width * im.height, 0.f));
+  im.past.resize(team + 1, std::vector<float>(im.width * im.height, 0.f));
+  im.unpublished.resize(team + 1, 1);
+}
+
+// linear falloff over path distance, bounded by radius
+static void spread(InfluenceMap &im, const DungeonData &dd, std::vector<float> &layer,
+                   size_t from, float strength, std::vector<size_t> &front, std::vector<size_t> &next)
+{
+  if (++im.generation == 0)
+  {
+    std::fill(im.visited.begin(), im.visited.end(), 0);
+    im.generation = 1;
+  }
+  front.clear();
+  front.push_back(from);
+  im.visited[from] = im.generation;
+  const float step = strength / float(im.radius + 1);
+  float value = strength;
+  for (int d = 0; d <= im.radius && !front.empty(); ++d, value -= step)
+  {
+    next.clear();
+    for (size_t idx : front)
+    {
+      layer[idx] += value;
+      const size_t x = idx % dd.width;
+      const size_t y = idx / dd.width;
+      auto visit = [&](size_t nx, size_t ny)
+      {
+        if (nx >= dd.width || ny >= dd.height)
+          return;
+        const size_t nidx = ny * dd.width + nx;
+        if (im.visited[nidx] == im.generation || dd.tiles[nidx] != dungeon::floor)
+          return;
+        im.visited[nidx] = im.generation;
+        next.push_back(nidx);
+      };
+      visit(x - 1, y);
+      visit(x + 1, y);
+      visit(x, y - 1);
+      visit(x, y + 1);
+    }
+    front.swap(next);
+  }
+}
+
+bool influence::update(flecs::world &ecs)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData>();
+  static auto membersQuery = ecs.query<const Position, const Team>();
+  static auto turnQuery = ecs.query<const TurnCounter>();
+  InfluenceMap *im = ecs.get_mut<InfluenceMap>();
+  if (!im)
+    return false;
+
+  // several player actions may happen in one turn, history fades only when the turn moves on,
+  // without a counter every update counts as a turn
+  int turn = im->lastTurn + 1;
+  turnQuery.each([&](const TurnCounter &tc) { turn = tc.count; });
+  if (turn != im->lastTurn)
+  {
+    // current layers become history, plain loops over contiguous layers are left to the compiler to vectorize
+    float fade = 1.f;
+    for (int t = im->lastTurn; t < turn; ++t)
+      fade *= im->decay;
+    for (size_t team = 0; team < im->teams.size(); ++team)
+    {
+      const std::vector<float> &layer = im->teams[team];
+      std::vector<float> &past = im->past[team];
+      for (size_t i = 0; i < layer.size(); ++i)
+        past[i] = layer[i] * fade;
+    }
+    im->lastTurn = turn;
+  }
+
+  bool published = false;
+  dungeonDataQuery.each([&](const DungeonData &dd)
+  {
+    // members standing together are spread once with summed strength
+    std::vector<std::unordered_map<size_t, float>> stacks;
+    membersQuery.each([&](const Position &pos, const Team &t)
+    {
+      if (t.team < 0)
+        return;
+      if (size_t(t.team) >= stacks.size())
+        stacks.resize(size_t(t.team) + 1);
+      stacks[size_t(t.team)][size_t(pos.y) * dd.width + size_t(pos.x)] += 1.f;
+    });
+    if (!stacks.empty())
+      ensure_team(*im, stacks.size() - 1);
+
+    // layer is rebuilt aside and replaces the old one only if it differs
+    std::vector<float> layer;
+    std::vector<size_t> front;
+    std::vector<size_t> next;
+    for (size_t team = 0; team < im->teams.size(); ++team)
+    {
+      layer = im->past[team];
+      if (team < stacks.size())
+        for (const auto &[idx, strength] : stacks[team])
+          spread(*im, dd, layer, idx, strength, front, next);
+      if (layer != im->teams[team])
+      {
+        im->teams[team].swap(layer);
+        im->unpublished[team] = 1;
+      }
+    }
+
+    const std::unordered_set<flecs::entity_t> referenced = dmaps::referenced_maps(ecs);
+    std::vector<float> map(dd.width * dd.height);
+    for (size_t team = 0; team < im->teams.size(); ++team)
+    {
+      if (!im->unpublished[team])
+        continue;
+      const std::string name = "influence_team" + std::to_string(team);
+      flecs::entity mapEntity = ecs.lookup(name.c_str());
+      if (!mapEntity || referenced.find(mapEntity.id()) == referenced.end())
+        continue;
+      const std::vector<float> &src = im->teams[team];
+      for (size_t i = 0; i < map.size(); ++i)
+        map[i] = dd.tiles[i] == dungeon::floor ? src[i] : dmaps::invalid_tile_value;
+      mapEntity.set(dmaps::quantize_map(map));
+      im->unpublished[team] = 0;
+      published = true;
+    }
+  });
+  return published;
+}
+
+float influence::own(const InfluenceMap &im, int team, const Position &pos)
+{
+  if (team < 0 || size_t(team) >= im.teams.size())
+    return 0.f;
+  return im.teams[size_t(team)][size_t(pos.y) * im.width + size_t(pos.x)];
+}
+
+float influence::danger(const InfluenceMap &im, int team, const Position &pos)
+{
+  float res = 0.f;
+  for (size_t t = 0; t < im.teams.size(); ++t)
+    if (int(t) != team)
+      res += im.teams[t][size_t(pos.y) * im.width + size_t(pos.x)];
+  return res;
+}
+
+float influence::control(const InfluenceMap &im, int team, const Position &pos)
+{
+  return own(im, team, pos) - danger(im, team, pos);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <flecs.h>
+#include "ecsTypes.h"
+
+// per team influence spread from its members, old influence fades by decay every turn
+struct InfluenceMap
+{
+  size_t width = 0;
+  size_t height = 0;
+  float decay = 0.5f; // share of influence kept from previous turn
+  int radius = 6; // how far over floor a single member spreads influence
+  std::vector<std::vector<float>> teams;
+  std::vector<std::vector<float>> past; // influence of previous turns already faded to lastTurn
+  std::vector<uint8_t> unpublished; // layer changed since its map was last set
+  int lastTurn = 0;
+
+  // scratch for bounded floods, tiles with current generation are already visited
+  std::vector<uint32_t> visited;
+  uint32_t generation = 0;
+};
+
+namespace influence
+{
+  InfluenceMap create(size_t w, size_t h, size_t num_teams);
+
+  // fades previous influence once per elapsed turn and adds current one of all Position+Team entities,
+  // then publishes changed "influence_team<N>" maps which DmapWeights or VisualiseMap reference,
+  // returns true only if some map was published
+  bool update(flecs::world &ecs);
+
+  float own(const InfluenceMap &im, int team, const Position &pos);
+  // sum of influence of all other teams
+  float danger(const InfluenceMap &im, int team, const Position &pos);
+  // own minus danger, positive where team dominates
+  float control(const InfluenceMap &im, int team, const Position &pos);
+};
@@ -8,6 +8,11 @@
 #include "dungeonUtils.h"
 #include "dijkstraMapGen.h"
 #include "dmapFollower.h"
+#include "fieldOfView.h"
+#include "exploration.h"
+#include "influenceMap.h"
+#include "dstarLite.h"
+#include "groupNav.h"
 
 constexpr bool horror_research_enabled = false;
 constexpr bool research_enabled = false;
@@ -28,7 +33,7 @@ static flecs::entity create_player_fleer(flecs::entity e)
 
 static flecs::entity create_hive_follower(flecs::entity e)
 {
-  e.set(DmapWeights{{{"hive_map", {1.f, 1.f}}}});
+  group_nav::join(e, "hive_pack");
   return e;
 }
 
@@ -154,7 +159,8 @@ static flecs::entity create_monster(flecs::world &ecs, Color col, const char *te
     .set(Team{1})
     .set(NumActions{1, 0})
     .set(MeleeDamage{20.f})
-    .set(Blackboard{});
+    .set(Blackboard{})
+    .set(ChasePath{});
 }
 
 static void create_player(flecs::world &ecs, const char *texture_src)
@@ -197,9 +203,16 @@ static void create_powerup(flecs::world &ecs, int x, int y, float amount)
     .set(Color{0xff, 0xff, 0x00, 0xff});
 }
 
+static bool is_explored_by_player(flecs::world &ecs, const Position &pos)
+{
+  const ExplorationMap *fog = ecs.get<ExplorationMap>();
+  return fog && fog->is_explored(0, size_t(pos.x), size_t(pos.y)); // player team hardcode
+}
+
 static void register_roguelike_systems(flecs::world &ecs)
 {
   static auto dungeonDataQuery = ecs.query<const DungeonData>();
+  register_dmap_followers(ecs);
   ecs.system<PlayerInput, Action, const IsPlayer>()
     .each([&](PlayerInput &inp, Action &a, const IsPlayer)
     {
@@ -228,16 +241,13 @@ static void register_roguelike_systems(flecs::world &ecs)
     .term<BackgroundTile>()
     .each([&](flecs::entity e, const Position &pos, const Color color)
     {
-      dungeonDataQuery.each([&](const DungeonData &dd)
+      if (is_explored_by_player(ecs, pos))
       {
-        if (dd.researchedTiles[pos.y * dd.width + pos.x])
-        {
-          const auto textureSrc = e.target<TextureSource>();
-          DrawTextureQuad(*textureSrc.get<Texture2D>(),
-            Vector2{ 1, 1 }, Vector2{ 0, 0 },
-            Rectangle{ float(pos.x) * tile_size, float(pos.y) * tile_size, tile_size, tile_size }, color);
-        }    
-      });
+        const auto textureSrc = e.target<TextureSource>();
+        DrawTextureQuad(*textureSrc.get<Texture2D>(),
+          Vector2{ 1, 1 }, Vector2{ 0, 0 },
+          Rectangle{ float(pos.x) * tile_size, float(pos.y) * tile_size, tile_size, tile_size }, color);
+      }
     });
   ecs.system<const Position, const Color>()
     .term<TextureSource>(flecs::Wildcard).not_()
@@ -251,33 +261,28 @@ static void register_roguelike_systems(flecs::world &ecs)
     .term<BackgroundTile>().not_()
     .each([&](flecs::entity e, const Position &pos, const Color color)
     {
-      dungeonDataQuery.each([&](const DungeonData &dd)
+      if (is_explored_by_player(ecs, pos))
       {
-        if (dd.researchedTiles[pos.y * dd.width + pos.x])
-        {
-          const auto textureSrc = e.target<TextureSource>();
-          DrawTextureQuad(*textureSrc.get<Texture2D>(),
-              Vector2{1, 1}, Vector2{0, 0},
-              Rectangle{float(pos.x) * tile_size, float(pos.y) * tile_size, tile_size, tile_size}, color);
-        }
-      });
+        const auto textureSrc = e.target<TextureSource>();
+        DrawTextureQuad(*textureSrc.get<Texture2D>(),
+            Vector2{1, 1}, Vector2{0, 0},
+            Rectangle{float(pos.x) * tile_size, float(pos.y) * tile_size, tile_size, tile_size}, color);
+      }
     });
   ecs.system<const Position, const Hitpoints>()
     .each([&](const Position &pos, const Hitpoints &hp)
     {
-      dungeonDataQuery.each([&](const DungeonData &dd){
-        if (dd.researchedTiles[pos.y * dd.width + pos.x])
-        {
-          constexpr float hpPadding = 0.05f;
-          const float hpWidth = 1.f - 2.f * hpPadding;
-          const Rectangle underRect = {float(pos.x + hpPadding) * tile_size, float(pos.y-0.25f) * tile_size,
-                                       hpWidth * tile_size, 0.1f * tile_size};
-          DrawRectangleRec(underRect, BLACK);
-          const Rectangle hpRect = {float(pos.x + hpPadding) * tile_size, float(pos.y-0.25f) * tile_size,
-                                    hp.hitpoints / 100.f * hpWidth * tile_size, 0.1f * tile_size};
-          DrawRectangleRec(hpRect, RED);
-        }
-      });
+      if (is_explored_by_player(ecs, pos))
+      {
+        constexpr float hpPadding = 0.05f;
+        const float hpWidth = 1.f - 2.f * hpPadding;
+        const Rectangle underRect = {float(pos.x + hpPadding) * tile_size, float(pos.y-0.25f) * tile_size,
+                                     hpWidth * tile_size, 0.1f * tile_size};
+        DrawRectangleRec(underRect, BLACK);
+        const Rectangle hpRect = {float(pos.x + hpPadding) * tile_size, float(pos.y-0.25f) * tile_size,
+                                  hp.hitpoints / 100.f * hpWidth * tile_size, 0.1f * tile_size};
+        DrawRectangleRec(hpRect, RED);
+      }
     });
 
   ecs.system<Texture2D>()
@@ -285,31 +290,25 @@ static void register_roguelike_systems(flecs::world &ecs)
     {
       SetTextureFilter(tex, TEXTURE_FILTER_POINT);
     });
-  ecs.system<const DmapWeights>()
+  ecs.system<const CompiledDmapWeights>()
     .term<VisualiseMap>()
-    .each([&](const DmapWeights &wt)
+    .each([&](const CompiledDmapWeights &cw)
     {
       dungeonDataQuery.each([&](const DungeonData &dd)
       {
-        for (size_t y = 0; y < dd.height; ++y)
-          for (size_t x = 0; x < dd.width; ++x)
-          {
-            float sum = 0.f;
-            for (const auto &pair : wt.weights)
+        cw.composite.get([&](const DijkstraMapData &dmap)
+        {
+          if (dmap.map.empty())
+            return;
+          for (size_t y = 0; y < dd.height; ++y)
+            for (size_t x = 0; x < dd.width; ++x)
             {
-              ecs.entity(pair.first.c_str()).get([&](const DijkstraMapData &dmap)
-              {
-                float v = dmap.map[y * dd.width + x];
-                if (v < 1e5f)
-                  sum += copysignf(powf(abs(v * pair.second.mult), pair.second.pow), v);
-                else
-                  sum += v;
-              });
+              const float sum = dmap.at(y * dd.width + x);
+              if (sum < 1e5f)
+                DrawText(TextFormat("%.1f", sum),
+                    (float(x) + 0.2f) * tile_size, (float(y) + 0.5f) * tile_size, 150, WHITE);
             }
-            if (sum < 1e5f)
-              DrawText(TextFormat("%.1f", sum),
-                  (float(x) + 0.2f) * tile_size, (float(y) + 0.5f) * tile_size, 150, WHITE);
-          }
+        });
       });
     });
 
@@ -322,7 +321,7 @@ static void register_roguelike_systems(flecs::world &ecs)
         for (size_t y = 0; y < dd.height; ++y)
           for (size_t x = 0; x < dd.width; ++x)
           {
-            const float val = dmap.map[y * dd.width + x];
+            const float val = dmap.at(y * dd.width + x);
             if (val < 1e5f)
               DrawText(TextFormat("%.1f", val),
                   (float(x) + 0.2f) * tile_size, (float(y) + 0.5f) * tile_size, 150, WHITE);
@@ -331,6 +330,27 @@ static void register_roguelike_systems(flecs::world &ecs)
     });
 }
 
+static void register_dmaps(flecs::world &ecs)
+{
+  dmaps::add_player_approach_map(ecs, "approach_map", { draw_function_example ? 2.f : 1.f, true });
+  if (draw_function_example)
+    ecs.entity("approach_map").add<VisualiseMap>();
+  dmaps::add_player_flee_map(ecs, "flee_map", { 1.f, true });
+  dmaps::add_hive_pack_map(ecs, "hive_map", { 1.f, true });
+  dmaps::add_archer_map(ecs, "archer_map", { 1.f, true });
+  if (archer_enabled)
+    ecs.entity("archer_map").add<VisualiseMap>();
+  dmaps::add_research_map(ecs, "research_map", { 1.f, true });
+  if (research_enabled)
+    ecs.entity("research_map").add<VisualiseMap>();
+  dmaps::add_flee_from_monster_map(ecs, "flee_from_monster_map", { 1.f, true });
+  //ecs.entity("flee_from_monster_map").add<VisualiseMap>();
+
+  if (horror_research_enabled)
+    ecs.entity("research_map_sum")
+      .set(DmapWeights{ {{"research_map", {1.0f, 1.0f}}, {"flee_from_monster_map", {2.5f, 0.9f}}} })
+      .add<VisualiseMap>();
+}
 
 void init_roguelike(flecs::world &ecs)
 {
@@ -363,6 +383,8 @@ void init_roguelike(flecs::world &ecs)
 
   create_player(ecs, "swordsman_tex");
 
+  register_dmaps(ecs);
+
   ecs.entity("world")
     .set(TurnCounter{})
     .set(ActionLog{});
@@ -376,16 +398,19 @@ void init_dungeon(flecs::world &ecs, char *tiles, size_t w, size_t h)
     .set(Texture2D{LoadTexture("assets/floor_resize.png")});
 
   std::vector<char> dungeonData;
-  std::vector<bool> researchedMap;
   dungeonData.resize(w * h);
-  researchedMap.resize(w * h);
+  ExplorationMap fog = exploration::create(w, h, 2);
   if (!(research_enabled || horror_research_enabled))
-    std::fill(researchedMap.begin(), researchedMap.end(), true);
+    exploration::reveal_all(fog, 0);
+  ecs.set(fog);
+  ecs.set(NearestTeamField{});
+  ecs.set(influence::create(w, h, 2));
   for (size_t y = 0; y < h; ++y)
     for (size_t x = 0; x < w; ++x)
       dungeonData[y * w + x] = tiles[y * w + x];
   ecs.entity("dungeon")
-    .set(DungeonData{dungeonData, researchedMap, w, h});
+    .set(DungeonData{dungeonData, w, h, 0})
+    .set(FovCache{});
 
   for (size_t y = 0; y < h; ++y)
     for (size_t x = 0; x < w; ++x)
@@ -456,7 +481,7 @@ static void process_actions(flecs::world &ecs)
   static auto processHeals = ecs.query<Action, Hitpoints>();
   static auto checkAttacks = ecs.query<const MovePos, Hitpoints, const Team>();
   static auto checkRangeAttacks = ecs.query<const MovePos, Hitpoints, const Team>();
-  static auto dungeonDataQuery = ecs.query<const DungeonData>();
+  static auto fovQuery = ecs.query<const DungeonData, FovCache>();
   // Process all actions
   ecs.defer([&]
   {
@@ -490,10 +515,14 @@ static void process_actions(flecs::world &ecs)
         if (a.action == EA_ARCHERY_SHOT && entity != enemy && team.team != enemy_team.team)
         {
           const float distToEnemy = dist(pos, epos);
-          if (distToEnemy <= dungeon::rangeDistance)
+          if (distToEnemy > dungeon::rangeDistance)
+            return;
+          const Position targetPos{epos.x, epos.y};
+          fovQuery.each([&](const DungeonData &dd, FovCache &cache)
           {
-            hp.hitpoints -= dmg.damage;
-          }
+            if (fov::has_los(cache, dd, pos, targetPos, dungeon::rangeDistance))
+              hp.hitpoints -= dmg.damage;
+          });
         }
       });
       if (blocked)
@@ -561,6 +590,8 @@ static void gather_world_info(flecs::world &ecs)
                                           const WorldInfoGatherer,
                                           const Team>();
   static auto alliesQuery = ecs.query<const Position, const Team>();
+  const NearestTeamField *field = ecs.get<NearestTeamField>();
+  const InfluenceMap *influenceMap = ecs.get<InfluenceMap>();
   gatherWorldInfo.each([&](Blackboard &bb, const Position &pos, const Hitpoints &hp,
                            WorldInfoGatherer, const Team &team)
   {
@@ -568,20 +599,47 @@ static void gather_world_info(flecs::world &ecs)
     push_info_to_bb(bb, "hp", hp.hitpoints);
     float numAllies = 0; // note float
     float closestEnemyDist = 100.f;
+    if (field)
+      closestEnemyDist = std::min(closestEnemyDist, dmaps::closest_enemy(*field, pos, team.team).dist);
     alliesQuery.each([&](const Position &apos, const Team &ateam)
     {
       constexpr float limitDist = 5.f;
       if (team.team == ateam.team && dist_sq(pos, apos) < sqr(limitDist))
         numAllies += 1.f;
-      if (team.team != ateam.team)
-      {
-        const float enemyDist = dist(pos, apos);
-        if (enemyDist < closestEnemyDist)
-          closestEnemyDist = enemyDist;
-      }
     });
     push_info_to_bb(bb, "alliesNum", numAllies);
     push_info_to_bb(bb, "enemyDist", closestEnemyDist);
+    if (influenceMap)
+    {
+      push_info_to_bb(bb, "danger", influence::danger(*influenceMap, team.team, pos));
+      push_info_to_bb(bb, "control", influence::control(*influenceMap, team.team, pos));
+    }
+  });
+}
+
+static void process_research(flecs::world &ecs)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData, FovCache>();
+  static auto explorersQuery = ecs.query<const Position, const Team>();
+  ExplorationMap *fog = ecs.get_mut<ExplorationMap>();
+  if (!fog)
+    return;
+  dungeonDataQuery.each([&](const DungeonData &dd, FovCache &cache)
+  {
+    std::vector<size_t> revealed;
+    explorersQuery.each([&](const Position &pos, const Team &team)
+    {
+      constexpr int radius_research = 2;
+      constexpr int radius_wallcheck = radius_research + 1;
+      revealed.clear();
+      for (size_t idx : fov::visible_tiles(cache, dd, pos, radius_wallcheck))
+      {
+        const Position tilePos{int(idx % dd.width), int(idx / dd.width)};
+        if (dd.tiles[idx] == dungeon::wall || dist_sq(pos, tilePos) <= float(sqr(radius_research)))
+          revealed.push_back(idx);
+      }
+      exploration::reveal(*fog, team.team, revealed);
+    });
   });
 }
 
@@ -592,9 +650,14 @@ void process_turn(flecs::world &ecs)
   static auto turnIncrementer = ecs.query<TurnCounter>();
   if (is_player_acted(ecs))
   {
+    // maps were built in background while previous frames were drawn
+    const bool mapsPublished = dmaps::publish_maps(ecs);
+    if (influence::update(ecs) || mapsPublished)
+      update_dmap_composites(ecs);
     if (upd_player_actions_count(ecs))
     {
       // Plan action for NPCs
+      dmaps::update_team_fields(ecs);
       gather_world_info(ecs);
       ecs.defer([&]
       {
@@ -607,72 +670,16 @@ void process_turn(flecs::world &ecs)
           bt.update(ecs, e, bb);
         });
         process_dmap_followers(ecs);
+        group_nav::process_packs(ecs);
       });
       turnIncrementer.each([](TurnCounter &tc) { tc.count++; });
     }
     process_actions(ecs);
 
-    std::vector<float> approachMap;
-    if (draw_function_example)
-    {
-      dmaps::gen_player_approach_map(ecs, approachMap, { 2.f, true });
-      ecs.entity("approach_map")
-        .add<VisualiseMap>();
-    }
-    else
-      dmaps::gen_player_approach_map(ecs, approachMap, { 1.f, true });
-
-    ecs.entity("approach_map")
-      .set(DijkstraMapData{ approachMap });
-    
-    if (!research_enabled)
-    { 
-      std::vector<float> fleeMap;
-      dmaps::gen_player_flee_map(ecs, fleeMap, { 1.f, true });
-      ecs.entity("flee_map")
-        .set(DijkstraMapData{ fleeMap });
-
-      std::vector<float> hiveMap;
-      dmaps::gen_hive_pack_map(ecs, hiveMap, { 1.f, true });
-      ecs.entity("hive_map")
-        .set(DijkstraMapData{ hiveMap });
-
-      //ecs.entity("flee_map").add<VisualiseMap>();
-      ecs.entity("hive_follower_sum")
-        .set(DmapWeights{ {{"hive_map", {1.f, 1.f}}, {"approach_map", {1.8f, 0.8f}}} });
-    }
-     
-    if (archer_enabled)
-    {
-      std::vector<float> archerMap;
-      dmaps::gen_archer_map(ecs, archerMap, { 1.f, true });
-      ecs.entity("archer_map")
-        .set(DijkstraMapData{archerMap})
-        .add<VisualiseMap>();
-    }
-
     if (research_enabled || horror_research_enabled)
-    {
-      std::vector<float> researchMap;
-      dmaps::gen_research_map(ecs, researchMap, { 1.f, true });
-      ecs.entity("research_map")
-        .set(DijkstraMapData{ researchMap });
-      if (research_enabled)
-        ecs.entity("research_map").add<VisualiseMap>();
-    }
+      process_research(ecs);
 
-    if (horror_research_enabled)
-    {
-      std::vector<float> fleeFromMonsterMap;
-      dmaps::gen_flee_from_monster_map(ecs, fleeFromMonsterMap, { 1.f, true });
-      ecs.entity("flee_from_monster_map")
-        .set(DijkstraMapData{ fleeFromMonsterMap });
-      //ecs.entity("flee_from_monster_map").add<VisualiseMap>();
-
-      ecs.entity("research_map_sum")
-        .set(DmapWeights{ {{"research_map", {1.0f, 1.0f}}, {"flee_from_monster_map", {2.5f, 0.9f}}} })
-        .add<VisualiseMap>();
-    }
+    dmaps::update_maps(ecs);
   }
 }
 
@@ -9,8 +9,11 @@ goap::Action goap::create_action(const char *name, const WorldDesc &desc, float
   {
     res.precondition.push_back(-1);
     res.effect.push_back(-1);
-    res.setBitset.push_back(true);
+    res.additive.push_back(0);
   }
+  for (size_t i = desc.size(); i < WorldState::max_vars; ++i)
+    res.additive.set(i, 0);
+  compile_action(res);
   return res;
 }
 
@@ -19,7 +22,7 @@ void goap::set_action_precond(Action &act, const WorldDesc &desc, const char *st
   auto itf = desc.find(st_name);
   if (itf == desc.end())
     return; // TODO: Assert
-  act.precondition[itf->second] = val;
+  act.precondition.set(itf->second, val);
 }
 
 void goap::set_action_effect(Action &act, const WorldDesc &desc, const char *st_name, int8_t val)
@@ -27,7 +30,7 @@ void goap::set_action_effect(Action &act, const WorldDesc &desc, const char *st_
   auto itf = desc.find(st_name);
   if (itf == desc.end())
     return; // TODO: Assert
-  act.effect[itf->second] = val;
+  act.effect.set(itf->second, val);
 }
 
 void goap::set_additive_action_effect(Action &act, const WorldDesc &desc, const char *st_name, int8_t val)
@@ -35,7 +38,16 @@ void goap::set_additive_action_effect(Action &act, const WorldDesc &desc, const
   auto itf = desc.find(st_name);
   if (itf == desc.end())
     return; // TODO: Assert
-  act.effect[itf->second] = val;
-  act.setBitset[itf->second] = false;
+  act.additive.set(itf->second, val);
+}
+
+void goap::compile_action(Action &act)
+{
+  act.precondMask = act.precondition.care_mask();
+  act.setMask = act.effect.care_mask();
+  act.additiveVars.clear();
+  for (size_t i = 0; i < act.additive.size(); ++i)
+    if (act.additive[i] != 0)
+      act.additiveVars.push_back(i);
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "goapWorldState.h"
 #include <string>
+#include <vector>
 
 namespace goap
 {
@@ -9,10 +10,14 @@ namespace goap
   {
     std::string name = "";
 
-    WorldState precondition;
-    WorldState effect;
+    WorldState precondition; // -1 where it doesn't matter
+    WorldState effect; // values which are set, -1 where nothing is set
+    WorldState additive; // values which are added, 0 where nothing is added
 
-    std::vector<bool> setBitset; // if effect sets world state, or is it additive (true - sets, false - additive)
+    // compiled by compile_action, 0xff bytes for variables precondition checks and effect sets
+    WorldState precondMask;
+    WorldState setMask;
+    std::vector<size_t> additiveVars;
 
     float cost = 1.f;
   };
@@ -21,5 +26,6 @@ namespace goap
   void set_action_precond(Action &act, const WorldDesc &desc, const char *st_name, int8_t val);
   void set_action_effect(Action &act, const WorldDesc &desc, const char *st_name, int8_t val);
   void set_additive_action_effect(Action &act, const WorldDesc &desc, const char *st_name, int8_t val);
+  void compile_action(Action &act);
 };
 
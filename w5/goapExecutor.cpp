@@ -0,0 +1,109 @@
+#include "goapExecutor.h"
+
+static bool action_applicable(const goap::Action &action, const goap::WorldState &ws)
+{
+  return ws.matches(action.precondition, action.precondMask);
+}
+
+static void update_relevant(goap::PlanExecutor &exec, const goap::Planner &planner)
+{
+  constexpr size_t numWords = goap::WorldState::num_words;
+  uint64_t setSoFar[numWords] = {};
+  const goap::WorldState goalMask = exec.goal.care_mask();
+  exec.relevant = goalMask;
+  for (size_t w = 0; w < numWords; ++w)
+    exec.relevant.words[w] = 0;
+  for (size_t i = exec.step; i < exec.plan.size(); ++i)
+  {
+    const goap::Action &action = planner.actions[exec.plan[i].action];
+    for (size_t w = 0; w < numWords; ++w)
+    {
+      exec.relevant.words[w] |= action.precondMask.words[w] & ~setSoFar[w];
+      setSoFar[w] |= action.setMask.words[w];
+    }
+  }
+  // counters which are only added to keep depending on their current value
+  for (size_t w = 0; w < numWords; ++w)
+    exec.relevant.words[w] |= goalMask.words[w] & ~setSoFar[w];
+}
+
+static void replan(goap::PlanExecutor &exec, const goap::Planner &planner, const goap::WorldState &from)
+{
+  exec.plan.clear();
+  exec.step = 0;
+  exec.expected = from;
+  if (exec.cache)
+    make_plan_cached(*exec.cache, planner, from, exec.goal, exec.plan);
+  else
+    make_plan(planner, from, exec.goal, exec.plan);
+  exec.valid = !exec.plan.empty() || from.matches(exec.goal, exec.goal.care_mask());
+  exec.numReplans++;
+  update_relevant(exec, planner);
+}
+
+// replays remaining steps from new state, rewrites their states when they still reach the goal
+static bool revalidate(goap::PlanExecutor &exec, const goap::Planner &planner, const goap::WorldState &from)
+{
+  exec.numValidations++;
+  std::vector<goap::WorldState> states;
+  goap::WorldState cur = from;
+  for (size_t i = exec.step; i < exec.plan.size(); ++i)
+  {
+    const size_t actId = exec.plan[i].action;
+    if (!action_applicable(planner.actions[actId], cur))
+      return false;
+    cur = goap::apply_action(planner, actId, cur);
+    states.push_back(cur);
+  }
+  if (!cur.matches(exec.goal, exec.goal.care_mask()))
+    return false;
+  for (size_t i = exec.step; i < exec.plan.size(); ++i)
+    exec.plan[i].worldState = states[i - exec.step];
+  exec.expected = from;
+  return true;
+}
+
+void goap::set_executor_goal(PlanExecutor &exec, const Planner &planner, const WorldState &from, const WorldState &goal)
+{
+  exec.goal = goal;
+  replan(exec, planner, from);
+}
+
+bool goap::update_executor(PlanExecutor &exec, const Planner &planner, const WorldState &sensed)
+{
+  if (!exec.valid)
+  {
+    // planning is deterministic, goal can't become reachable from the state it already failed from
+    if (sensed == exec.expected)
+      return false;
+    replan(exec, planner, sensed);
+    return true;
+  }
+  uint64_t diff = 0;
+  for (size_t w = 0; w < WorldState::num_words; ++w)
+    diff |= (sensed.words[w] ^ exec.expected.words[w]) & exec.relevant.words[w];
+  if (diff == 0)
+  {
+    // nothing remaining steps read has changed, plan stays as is
+    exec.expected = sensed;
+    return false;
+  }
+  if (revalidate(exec, planner, sensed))
+    return false;
+  replan(exec, planner, sensed);
+  return true;
+}
+
+size_t goap::current_action(const PlanExecutor &exec)
+{
+  return exec.valid && exec.step < exec.plan.size() ? exec.plan[exec.step].action : size_t(-1);
+}
+
+void goap::advance_executor(PlanExecutor &exec, const Planner &planner)
+{
+  if (!exec.valid || exec.step >= exec.plan.size())
+    return;
+  exec.expected = exec.plan[exec.step].worldState;
+  exec.step++;
+  update_relevant(exec, planner);
+}
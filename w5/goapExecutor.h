@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+
+#include "goapPlanner.h"
+#include "goapPlanCache.h"
+
+namespace goap
+{
+  // keeps a plan and replans only when sensors change something its remaining steps depend on
+  struct PlanExecutor
+  {
+    WorldState goal;
+    std::vector<PlanStep> plan;
+    size_t step = 0; // next step to execute
+    bool valid = false;
+
+    WorldState expected; // state the remaining steps were planned or validated from, or planning failed from
+    WorldState relevant; // 0xff bytes for variables which are read before the plan sets them
+
+    PlanCache *cache = nullptr; // optional, plans through it when set
+
+    size_t numReplans = 0;
+    size_t numValidations = 0;
+  };
+
+  void set_executor_goal(PlanExecutor &exec, const Planner &planner, const WorldState &from, const WorldState &goal);
+  // sensor update, returns true when the plan had to be rebuilt,
+  // failed plan is retried only once sensed state differs from the one it failed from
+  bool update_executor(PlanExecutor &exec, const Planner &planner, const WorldState &sensed);
+  // size_t(-1) when plan is finished or there's none
+  size_t current_action(const PlanExecutor &exec);
+  void advance_executor(PlanExecutor &exec, const Planner &planner);
+};
+
@@ -0,0 +1,163 @@
+#include "goapHeuristic.h"
+#include "goapPlanner.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <queue>
+
+// largest change action can make to a variable inside its domain
+static int max_change(const goap::Planner &planner, const goap::Action &action, size_t var)
+{
+  if (action.effect[var] >= 0)
+    return std::max(action.effect[var] - planner.domainMin[var], planner.domainMax[var] - action.effect[var]);
+  return std::min(abs(action.additive[var]), planner.domainMax[var] - planner.domainMin[var]);
+}
+
+float goap::heuristic_difference(const Planner &, const WorldState &from, const WorldState &to)
+{
+  float cost = 0;
+  for (size_t i = 0; i < to.size(); ++i)
+    if (to[i] >= 0) // we care about it
+      cost += float(abs(to[i] - from[i]));
+  return cost;
+}
+
+float goap::heuristic_action_cost(const Planner &planner, const WorldState &from, const WorldState &to)
+{
+  const std::vector<float> &unitCost = planner.heuristicData.unitCost;
+  float cost = 0;
+  for (size_t i = 0; i < to.size(); ++i)
+    if (to[i] >= 0 && from[i] >= 0)
+      cost += unitCost[i] * float(abs(to[i] - from[i]));
+  return cost;
+}
+
+static float pattern_distance(const goap::Planner &planner, const goap::PatternDatabase &pdb, const goap::WorldState &from)
+{
+  size_t idx = 0;
+  for (size_t k = 0; k < pdb.vars.size(); ++k)
+  {
+    const size_t var = pdb.vars[k];
+    if (from[var] < planner.domainMin[var] || from[var] > planner.domainMax[var])
+      return 0.f;
+    idx += size_t(from[var] - planner.domainMin[var]) * pdb.strides[k];
+  }
+  return pdb.dist[idx];
+}
+
+float goap::heuristic_pattern_db(const Planner &planner, const WorldState &from, const WorldState &to)
+{
+  float res = heuristic_action_cost(planner, from, to);
+  for (const PatternDatabase &pdb : planner.heuristicData.patterns)
+    if (pdb.goal == to)
+      res = std::max(res, pattern_distance(planner, pdb, from));
+  return res;
+}
+
+void goap::prepare_heuristic(Planner &planner)
+{
+  // every action splits its cost over all units of change it can make, so sums of unit costs never overestimate
+  std::vector<float> &unitCost = planner.heuristicData.unitCost;
+  unitCost.assign(planner.wdesc.size(), std::numeric_limits<float>::infinity());
+  for (const Action &action : planner.actions)
+  {
+    int totalChange = 0;
+    for (size_t i = 0; i < planner.wdesc.size(); ++i)
+      totalChange += max_change(planner, action, i);
+    if (totalChange == 0)
+      continue;
+    for (size_t i = 0; i < planner.wdesc.size(); ++i)
+      if (max_change(planner, action, i) > 0)
+        unitCost[i] = std::min(unitCost[i], action.cost / float(totalChange));
+  }
+  // variables no action changes can't be fixed at all, but their mismatch is caught by goal test anyway
+  for (float &cost : unitCost)
+    if (std::isinf(cost))
+      cost = 0.f;
+  planner.heuristic = heuristic_action_cost;
+}
+
+bool goap::add_pattern_database(Planner &planner, const std::vector<std::string> &vars, const WorldState &goal)
+{
+  PatternDatabase pdb;
+  pdb.goal = goal;
+  size_t numStates = 1;
+  for (const std::string &name : vars)
+  {
+    auto itf = planner.wdesc.find(name);
+    if (itf == planner.wdesc.end())
+    {
+      fprintf(stderr, "goap: pattern database uses unknown state '%s'\n", name.c_str());
+      return false;
+    }
+    pdb.vars.push_back(itf->second);
+    pdb.strides.push_back(numStates);
+    numStates *= size_t(planner.domainMax[itf->second] - planner.domainMin[itf->second] + 1);
+    if (numStates > (1 << 16))
+    {
+      fprintf(stderr, "goap: pattern database over %zu states is too large\n", numStates);
+      return false;
+    }
+  }
+  if (planner.heuristicData.unitCost.empty())
+    prepare_heuristic(planner);
+
+  auto value = [&](size_t idx, size_t k)
+  {
+    const size_t var = pdb.vars[k];
+    const size_t range = size_t(planner.domainMax[var] - planner.domainMin[var] + 1);
+    return int((idx / pdb.strides[k]) % range) + planner.domainMin[var];
+  };
+
+  // abstract transitions ignore everything outside of pattern, so they only ever make paths shorter
+  std::vector<std::vector<std::pair<size_t, float>>> reverseEdges(numStates);
+  for (size_t idx = 0; idx < numStates; ++idx)
+    for (const Action &action : planner.actions)
+    {
+      size_t next = 0;
+      bool applicable = true;
+      for (size_t k = 0; k < pdb.vars.size() && applicable; ++k)
+      {
+        const size_t var = pdb.vars[k];
+        int val = value(idx, k);
+        applicable = action.precondition[var] < 0 || action.precondition[var] == val;
+        if (action.effect[var] >= 0)
+          val = action.effect[var];
+        val = std::clamp(val + action.additive[var], int(planner.domainMin[var]), int(planner.domainMax[var]));
+        next += size_t(val - planner.domainMin[var]) * pdb.strides[k];
+      }
+      if (applicable && next != idx)
+        reverseEdges[next].emplace_back(idx, action.cost);
+    }
+
+  pdb.dist.assign(numStates, std::numeric_limits<float>::infinity());
+  using QueueEntry = std::pair<float, size_t>;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+  for (size_t idx = 0; idx < numStates; ++idx)
+  {
+    bool isGoal = true;
+    for (size_t k = 0; k < pdb.vars.size(); ++k)
+      isGoal &= goal[pdb.vars[k]] < 0 || goal[pdb.vars[k]] == value(idx, k);
+    if (!isGoal)
+      continue;
+    pdb.dist[idx] = 0.f;
+    queue.emplace(0.f, idx);
+  }
+  while (!queue.empty())
+  {
+    const auto [d, idx] = queue.top();
+    queue.pop();
+    if (d > pdb.dist[idx])
+      continue;
+    for (const auto &[prev, cost] : reverseEdges[idx])
+      if (d + cost < pdb.dist[prev])
+      {
+        pdb.dist[prev] = d + cost;
+        queue.emplace(d + cost, prev);
+      }
+  }
+  planner.heuristicData.patterns.push_back(std::move(pdb));
+  planner.heuristic = heuristic_pattern_db;
+  return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+
+#include "goapWorldState.h"
+
+namespace goap
+{
+  struct Planner;
+
+  using Heuristic = float (*)(const Planner &planner, const WorldState &from, const WorldState &to);
+
+  // exact distances to a fixed goal in the state space projected onto a few variables
+  struct PatternDatabase
+  {
+    std::vector<size_t> vars;
+    std::vector<size_t> strides; // index of abstract state is sum of (value - min) * stride
+    WorldState goal;
+    std::vector<float> dist; // infinity when goal can't be reached
+  };
+
+  struct HeuristicData
+  {
+    // admissible cost of changing variable by one, action costs are shared between all variables they change
+    std::vector<float> unitCost;
+    std::vector<PatternDatabase> patterns;
+  };
+
+  // sum of absolute differences, fast but ignores action costs and isn't admissible
+  float heuristic_difference(const Planner &planner, const WorldState &from, const WorldState &to);
+  // admissible, needs prepare_heuristic
+  float heuristic_action_cost(const Planner &planner, const WorldState &from, const WorldState &to);
+  // admissible, maximum of action cost heuristic and pattern databases built for this goal
+  float heuristic_pattern_db(const Planner &planner, const WorldState &from, const WorldState &to);
+
+  // call after all actions and domains are added, switches planner to heuristic_action_cost
+  void prepare_heuristic(Planner &planner);
+  // product of domains of vars should be small, switches planner to heuristic_pattern_db
+  // false and planner is left as is when a variable is unknown or the pattern is too large
+  bool add_pattern_database(Planner &planner, const std::vector<std::string> &vars, const WorldState &goal);
+};
+
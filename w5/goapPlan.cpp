@@ -1,85 +1,421 @@
 #include "goapPlanner.h"
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 struct PlanNode
 {
   goap::WorldState worldState;
-  goap::WorldState prevState;
 
   float g = 0;
   float h = 0;
 
   size_t actionId;
+  size_t parent; // index in nodes
+  size_t heapIdx = size_t(-1); // position in open heap, -1 when closed
 };
 
-static float heuristic(const goap::WorldState &from, const goap::WorldState &to)
+// binary heap of node indices, ties are broken by node index which is the order nodes were discovered in
+struct OpenHeap
 {
-  float cost = 0;
-  for (size_t i = 0; i < to.size(); ++i)
-    if (to[i] >= 0) // we care about it
-      cost += float(abs(to[i] - from[i]));
-  return cost;
-}
+  std::vector<PlanNode> &nodes;
+  std::vector<size_t> &heap;
 
-static void reconstruct_plan(PlanNode &goal_node, const std::vector<PlanNode> &closed, std::vector<goap::PlanStep> &plan)
-{
-  PlanNode &curNode = goal_node;
-  while (curNode.actionId != size_t(-1))
+  bool less(size_t lhs, size_t rhs) const
+  {
+    const float lf = nodes[lhs].g + nodes[lhs].h;
+    const float rf = nodes[rhs].g + nodes[rhs].h;
+    return lf < rf || (lf == rf && lhs < rhs);
+  }
+
+  void place(size_t pos, size_t node)
+  {
+    heap[pos] = node;
+    nodes[node].heapIdx = pos;
+  }
+
+  void sift_up(size_t pos)
+  {
+    const size_t node = heap[pos];
+    while (pos > 0 && less(node, heap[(pos - 1) / 2]))
+    {
+      place(pos, heap[(pos - 1) / 2]);
+      pos = (pos - 1) / 2;
+    }
+    place(pos, node);
+  }
+
+  void sift_down(size_t pos)
+  {
+    const size_t node = heap[pos];
+    while (true)
+    {
+      size_t child = pos * 2 + 1;
+      if (child >= heap.size())
+        break;
+      if (child + 1 < heap.size() && less(heap[child + 1], heap[child]))
+        ++child;
+      if (!less(heap[child], node))
+        break;
+      place(pos, heap[child]);
+      pos = child;
+    }
+    place(pos, node);
+  }
+
+  void push(size_t node)
+  {
+    heap.push_back(node);
+    sift_up(heap.size() - 1);
+  }
+
+  size_t pop()
   {
-    plan.push_back({curNode.actionId, curNode.worldState});
-    auto itf = std::find_if(closed.begin(), closed.end(), [&](const PlanNode &n) { return n.worldState == curNode.prevState; });
-    curNode = *itf;
+    const size_t res = heap.front();
+    nodes[res].heapIdx = size_t(-1);
+    const size_t last = heap.back();
+    heap.pop_back();
+    if (!heap.empty())
+    {
+      place(0, last);
+      sift_down(0);
+    }
+    return res;
   }
+
+  bool empty() const { return heap.empty(); }
+};
+
+static void reconstruct_plan(const std::vector<PlanNode> &nodes, size_t goal_node, std::vector<goap::PlanStep> &plan)
+{
+  for (size_t cur = goal_node; nodes[cur].actionId != size_t(-1); cur = nodes[cur].parent)
+    plan.push_back({nodes[cur].actionId, nodes[cur].worldState});
   std::reverse(plan.begin(), plan.end());
 }
 
-float goap::make_plan(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan)
+// search buffers are kept per thread, so repeated and concurrent plans don't allocate them again
+struct PlanScratch
+{
+  std::vector<PlanNode> nodes;
+  std::unordered_map<goap::WorldState, size_t> nodeIndices;
+  std::vector<size_t> heap;
+};
+
+float goap::make_plan(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan,
+                      PlanStats *stats)
 {
-  std::vector<PlanNode> openList = {PlanNode{from, from, 0, heuristic(from, to), size_t(-1)}};
-  std::vector<PlanNode> closedList = {};
-  while (!openList.empty())
-  {
-    auto minIt = openList.begin();
-    float minF = minIt->g + minIt->h;
-    for (auto it = openList.begin(); it != openList.end(); ++it)
-      if (it->g + it->h < minF)
+  const Heuristic heuristic = planner.heuristic;
+  const WorldState goalMask = to.care_mask();
+  thread_local PlanScratch scratch;
+  std::vector<PlanNode> &nodes = scratch.nodes;
+  std::unordered_map<WorldState, size_t> &nodeIndices = scratch.nodeIndices;
+  nodes.clear();
+  nodeIndices.clear();
+  nodes.push_back(PlanNode{from, 0, heuristic(planner, from, to), size_t(-1), size_t(-1)});
+  nodeIndices.emplace(from, 0);
+  scratch.heap.clear();
+  OpenHeap openList{nodes, scratch.heap};
+  openList.push(0);
+  float res = 0.f;
+  size_t numExpanded = 0;
+  while (!openList.empty() && (!planner.maxExpandedNodes || numExpanded < planner.maxExpandedNodes))
+  {
+    const size_t cur = openList.pop();
+    ++numExpanded;
+    if (nodes[cur].worldState.matches(to, goalMask)) // we've reached our goal
+    {
+      reconstruct_plan(nodes, cur, plan);
+      res = nodes[cur].g;
+      break;
+    }
+    std::vector<size_t> transitions = find_valid_state_transitions(planner, nodes[cur].worldState);
+    for (size_t actId : transitions)
+    {
+      WorldState st = apply_action(planner, actId, nodes[cur].worldState);
+      const float score = nodes[cur].g + get_action_cost(planner, actId);
+      if (!is_within_domains(planner, st) || (planner.maxPlanCost > 0.f && score > planner.maxPlanCost))
+        continue;
+      auto itf = nodeIndices.find(st);
+      if (itf == nodeIndices.end())
+      {
+        const size_t idx = nodes.size();
+        nodes.push_back({st, score, heuristic(planner, st, to), actId, cur});
+        nodeIndices.emplace(st, idx);
+        openList.push(idx);
+        continue;
+      }
+      // better way into already known state, closed ones are only relinked and not reopened
+      PlanNode &node = nodes[itf->second];
+      if (score < node.g)
       {
-        minF = it->g + it->h;
-        minIt = it;
+        node.g = score;
+        node.parent = cur;
+        node.actionId = actId;
+        if (node.heapIdx != size_t(-1))
+          openList.sift_up(node.heapIdx);
       }
-    PlanNode cur = *minIt;
-    openList.erase(minIt);
-    if (heuristic(cur.worldState, to) == 0) // we've reached our goal
+    }
+  }
+  if (stats)
+  {
+    stats->expandedNodes = numExpanded;
+    stats->generatedNodes = nodes.size();
+  }
+  return res;
+}
+
+// threads live until exit, so their thread_local scratch is reused by every batch
+struct PlanWorkers
+{
+  std::mutex batchMutex; // one batch at a time
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable finished;
+  std::vector<std::thread> threads;
+  std::function<void()> job;
+  size_t batch = 0;
+  size_t numActive = 0; // workers which take part in current batch
+  size_t numBusy = 0;
+  bool quit = false;
+
+  ~PlanWorkers()
+  {
     {
-      reconstruct_plan(cur, closedList, plan);
-      return minF;
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
     }
-    closedList.push_back(cur);
-    std::vector<size_t> transitions = find_valid_state_transitions(planner, cur.worldState);
-    //const bool firstIter = openList.empty();
-    //printf("------------\n");
-    for (size_t actId : transitions)
+    wake.notify_all();
+    for (std::thread &t : threads)
+      t.join();
+  }
+
+  void work(size_t idx)
+  {
+    size_t seenBatch = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+      wake.wait(lock, [&]() { return quit || batch != seenBatch; });
+      if (quit)
+        return;
+      seenBatch = batch;
+      if (idx >= numActive)
+        continue;
+      lock.unlock();
+      job();
+      lock.lock();
+      if (--numBusy == 0)
+        finished.notify_one();
+    }
+  }
+
+  // runs job on num_helpers workers and on the calling thread, returns when all of them are done
+  void run(size_t num_helpers, const std::function<void()> &batch_job)
+  {
+    std::lock_guard<std::mutex> batchLock(batchMutex);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      while (threads.size() < num_helpers)
+        threads.emplace_back(&PlanWorkers::work, this, threads.size());
+      job = batch_job;
+      numActive = num_helpers;
+      numBusy = num_helpers;
+      ++batch;
+    }
+    wake.notify_all();
+    batch_job();
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&]() { return numBusy == 0; });
+  }
+};
+
+void goap::make_plans(const std::vector<PlanRequest> &requests, std::vector<PlanResult> &results, size_t num_threads)
+{
+  results.clear();
+  results.resize(requests.size());
+  if (num_threads == 0)
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  num_threads = std::min(num_threads, requests.size());
+  if (num_threads == 0)
+    return;
+
+  // workers grab requests one by one, every result has its own slot so order doesn't depend on timing
+  std::atomic<size_t> next = 0;
+  auto worker = [&]()
+  {
+    for (size_t i = next++; i < requests.size(); i = next++)
+    {
+      const PlanRequest &req = requests[i];
+      results[i].cost = make_plan(*req.planner, req.from, req.to, results[i].plan);
+    }
+  };
+  static PlanWorkers workers;
+  workers.run(num_threads - 1, worker); // calling thread works too
+}
+
+// goal in state before action, false if action is irrelevant or contradicts the goal
+static bool regress_goal(const goap::Planner &planner, const goap::Action &action, const goap::WorldState &goal,
+                         const goap::WorldState &max_vals, goap::WorldState &res)
+{
+  res = goal;
+  bool achieves = false;
+  for (size_t i = 0; i < goal.size(); ++i)
+  {
+    int val = goal[i];
+    // no state outside of domain is reachable, saturation would make subtraction below lie about it
+    if (val >= 0 && (val < planner.domainMin[i] || val > planner.domainMax[i]))
+      return false;
+    if (val >= 0 && action.effect[i] >= 0)
+    {
+      if (action.effect[i] != val)
+        return false;
+      achieves = true;
+      val = -1; // action sets it, so it doesn't matter before
+    }
+    else if (val >= 0 && action.additive[i] != 0)
+    {
+      val -= action.additive[i];
+      if (val < planner.domainMin[i] || val > max_vals[i])
+        return false;
+      achieves = true;
+    }
+    if (action.precondition[i] >= 0)
+    {
+      if (val >= 0 && val != action.precondition[i])
+        return false;
+      val = action.precondition[i];
+    }
+    res.set(i, int8_t(val));
+  }
+  return achieves;
+}
+
+float goap::make_plan_regressive(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan,
+                                 PlanStats *stats)
+{
+  // nodes are regressed goals, heuristic measures how far start is from satisfying them
+  const Heuristic heuristic = planner.heuristic;
+  std::vector<PlanNode> nodes = {PlanNode{to, 0, heuristic(planner, from, to), size_t(-1), size_t(-1)}};
+  std::unordered_map<WorldState, size_t> nodeIndices = {{to, 0}};
+  std::vector<size_t> heap;
+  OpenHeap openList{nodes, heap};
+  openList.push(0);
+  // additive effects could regress a counter forever, values are kept within what start, goal and actions mention
+  WorldState maxVals = from;
+  for (size_t i = 0; i < maxVals.size(); ++i)
+  {
+    int8_t maxVal = std::max(from[i], to[i]);
+    for (const Action &action : planner.actions)
+      maxVal = std::max({maxVal, action.precondition[i], action.effect[i]});
+    maxVals.set(i, std::min(maxVal, planner.domainMax[i]));
+  }
+  std::vector<uint8_t> candidate(planner.actions.size(), 0);
+  std::vector<size_t> candidates;
+  // a goal which demands everything an expanded one does at no lower cost is useless,
+  // expanded goal with given mask is its projection to the mask, so only distinct masks are scanned
+  std::vector<uint8_t> expanded;
+  std::vector<WorldState> expandedMasks;
+  auto is_subsumed = [&](const WorldState &goal, float score)
+  {
+    const WorldState careMask = goal.care_mask();
+    for (const WorldState &mask : expandedMasks)
     {
-      //printf("valid action: %s\n", planner.actions[actId].name.c_str());
-      WorldState st = apply_action(planner, actId, cur.worldState);
-      const float score = cur.g + get_action_cost(planner, actId);
-      auto openIt = std::find_if(openList.begin(), openList.end(), [&](const PlanNode &n) { return st == n.worldState; });
-      auto closeIt = std::find_if(closedList.begin(), closedList.end(), [&](const PlanNode &n) { return st == n.worldState; });
-      if (openIt != openList.end() && score < openIt->g)
+      if (!mask.mask_within(careMask))
+        continue;
+      auto itf = nodeIndices.find(goal.projected(mask));
+      if (itf != nodeIndices.end() && itf->second < expanded.size() && expanded[itf->second] &&
+          nodes[itf->second].g <= score)
+        return true;
+    }
+    return false;
+  };
+  const size_t planStart = plan.size();
+  const WorldState goalMask = to.care_mask();
+  float res = 0.f;
+  size_t numExpanded = 0;
+  while (!openList.empty() && (!planner.maxExpandedNodes || numExpanded < planner.maxExpandedNodes))
+  {
+    const size_t cur = openList.pop();
+    if (is_subsumed(nodes[cur].worldState, nodes[cur].g))
+      continue;
+    ++numExpanded;
+    if (from.matches(nodes[cur].worldState, nodes[cur].worldState.care_mask())) // start satisfies regressed goal
+    {
+      // chain from here to the goal is already in execution order, it's replayed forward as saturating effects
+      // may not do what regression assumed
+      WorldState st = from;
+      bool valid = true;
+      for (size_t node = cur; valid && nodes[node].actionId != size_t(-1); node = nodes[node].parent)
+      {
+        const Action &action = planner.actions[nodes[node].actionId];
+        valid = st.matches(action.precondition, action.precondMask);
+        st = apply_action(planner, nodes[node].actionId, st);
+        valid = valid && is_within_domains(planner, st);
+        plan.push_back({nodes[node].actionId, st});
+      }
+      if (valid && st.matches(to, goalMask))
+      {
+        res = nodes[cur].g;
+        break;
+      }
+      plan.resize(planStart);
+      continue;
+    }
+    if (cur >= expanded.size())
+      expanded.resize(cur + 1, 0);
+    expanded[cur] = 1;
+    const WorldState careMask = nodes[cur].worldState.care_mask();
+    if (std::find(expandedMasks.begin(), expandedMasks.end(), careMask) == expandedMasks.end())
+      expandedMasks.push_back(careMask);
+    // only actions which touch variables goal cares about
+    candidates.clear();
+    for (size_t i = 0; i < nodes[cur].worldState.size(); ++i)
+      if (nodes[cur].worldState[i] >= 0)
+        for (size_t actId : planner.effectActions[i])
+          if (!candidate[actId])
+          {
+            candidate[actId] = 1;
+            candidates.push_back(actId);
+          }
+    for (size_t actId : candidates)
+    {
+      candidate[actId] = 0;
+      WorldState st;
+      if (!regress_goal(planner, planner.actions[actId], nodes[cur].worldState, maxVals, st))
+        continue;
+      const float score = nodes[cur].g + get_action_cost(planner, actId);
+      if ((planner.maxPlanCost > 0.f && score > planner.maxPlanCost) || is_subsumed(st, score))
+        continue;
+      auto itf = nodeIndices.find(st);
+      if (itf == nodeIndices.end())
       {
-        openIt->g = score;
-        openIt->prevState = cur.worldState;
+        const size_t idx = nodes.size();
+        nodes.push_back({st, score, heuristic(planner, from, st), actId, cur});
+        nodeIndices.emplace(st, idx);
+        openList.push(idx);
+        continue;
       }
-      if (closeIt != closedList.end() && score < closeIt->g)
+      PlanNode &node = nodes[itf->second];
+      if (score < node.g)
       {
-        closeIt->g = score;
-        closeIt->prevState = cur.worldState;
+        node.g = score;
+        node.parent = cur;
+        node.actionId = actId;
+        if (node.heapIdx != size_t(-1))
+          openList.sift_up(node.heapIdx);
       }
-      if (closeIt == closedList.end() && openIt == openList.end())
-        openList.push_back({st, cur.worldState, score, heuristic(st, to), actId});
     }
   }
-  return 0.f;
+  if (stats)
+  {
+    stats->expandedNodes = numExpanded;
+    stats->generatedNodes = nodes.size();
+  }
+  return res;
 }
 
 void goap::print_plan(const Planner &planner, const WorldState &init, const std::vector<PlanStep> &plan)
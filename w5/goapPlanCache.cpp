@@ -0,0 +1,50 @@
+#include "goapPlanCache.h"
+
+float goap::make_plan_cached(PlanCache &cache, const Planner &planner, const WorldState &from, const WorldState &to,
+                             std::vector<PlanStep> &plan)
+{
+  const PlanCache::Key key{planner.id.value, from, to};
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto itf = cache.entries.find(key);
+    if (itf != cache.entries.end())
+    {
+      cache.lru.splice(cache.lru.begin(), cache.lru, itf->second);
+      cache.stats.hits++;
+      plan = itf->second->plan;
+      return itf->second->cost;
+    }
+    cache.stats.misses++;
+  }
+
+  // planning is done unlocked, agents racing for the same key just plan twice and store the same plan
+  plan.clear();
+  const float cost = make_plan(planner, from, to, plan);
+
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  if (cache.capacity == 0 || cache.entries.count(key))
+    return cost;
+  cache.lru.push_front(PlanCache::Entry{key, cost, plan});
+  cache.entries.emplace(key, cache.lru.begin());
+  while (cache.lru.size() > cache.capacity)
+  {
+    cache.entries.erase(cache.lru.back().key);
+    cache.lru.pop_back();
+    cache.stats.evictions++;
+  }
+  return cost;
+}
+
+goap::PlanCacheStats goap::get_cache_stats(const PlanCache &cache)
+{
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  return cache.stats;
+}
+
+void goap::clear_plan_cache(PlanCache &cache)
+{
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.entries.clear();
+  cache.lru.clear();
+  cache.stats = PlanCacheStats();
+}
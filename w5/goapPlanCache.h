@@ -0,0 +1,62 @@
+#pragma once
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "goapPlanner.h"
+
+namespace goap
+{
+  struct PlanCacheStats
+  {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+  };
+
+  // plans shared between all agents using the same planner, least recently used plans are evicted first
+  // planners are expected to be fully built before their plans get cached
+  struct PlanCache
+  {
+    struct Key
+    {
+      size_t plannerId;
+      WorldState from;
+      WorldState to;
+
+      bool operator==(const Key &rhs) const { return plannerId == rhs.plannerId && from == rhs.from && to == rhs.to; }
+    };
+
+    struct KeyHash
+    {
+      size_t operator()(const Key &key) const
+      {
+        size_t h = key.plannerId * 0x9e3779b97f4a7c15ull;
+        h = (h ^ key.from.hash()) * 0xbf58476d1ce4e5b9ull;
+        return (h ^ key.to.hash()) * 0x94d049bb133111ebull;
+      }
+    };
+
+    struct Entry
+    {
+      Key key;
+      float cost;
+      std::vector<PlanStep> plan;
+    };
+
+    size_t capacity = 256;
+    std::list<Entry> lru; // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> entries;
+    PlanCacheStats stats;
+    mutable std::mutex mutex;
+  };
+
+  // same as make_plan, but plans only on a cache miss, safe to call from several threads
+  float make_plan_cached(PlanCache &cache, const Planner &planner, const WorldState &from, const WorldState &to,
+                         std::vector<PlanStep> &plan);
+
+  PlanCacheStats get_cache_stats(const PlanCache &cache);
+  void clear_plan_cache(PlanCache &cache);
+};
+
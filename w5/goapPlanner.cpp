@@ -1,4 +1,15 @@
 #include "goapPlanner.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <limits>
+
+goap::PlannerId::PlannerId()
+{
+  static std::atomic<size_t> nextId = 1;
+  value = nextId++;
+}
 
 goap::Planner goap::create_planner()
 {
@@ -8,7 +19,34 @@ goap::Planner goap::create_planner()
 void goap::add_states_to_planner(Planner &planner, const std::vector<std::string> &state_names)
 {
   for (const std::string &name : state_names)
+  {
+    WorldState::check_capacity(planner.wdesc.size());
     planner.wdesc.emplace(name, planner.wdesc.size());
+    planner.domainMin.push_back(0);
+    planner.domainMax.push_back(std::numeric_limits<int8_t>::max());
+  }
+}
+
+bool goap::set_state_domain(Planner &planner, const char *st_name, int8_t min_val, int8_t max_val)
+{
+  auto itf = planner.wdesc.find(st_name);
+  if (itf == planner.wdesc.end())
+  {
+    fprintf(stderr, "goap: domain of unknown state '%s'\n", st_name);
+    return false;
+  }
+  assert(min_val >= 0 && min_val <= max_val);
+  planner.domainMin.set(itf->second, min_val);
+  planner.domainMax.set(itf->second, max_val);
+  return true;
+}
+
+bool goap::is_within_domains(const Planner &planner, const WorldState &ws)
+{
+  for (size_t i = 0; i < ws.size(); ++i)
+    if (ws[i] >= 0 && (ws[i] < planner.domainMin[i] || ws[i] > planner.domainMax[i]))
+      return false;
+  return true;
 }
 
 
@@ -24,6 +62,18 @@ void goap::add_action_to_planner(Planner &planner, const char *name, float cost,
   for (auto st : additive_effect)
     set_additive_action_effect(act, planner.wdesc, st.first, int8_t(st.second));
 
+  compile_action(act);
+  for (size_t w = 0; w < WorldState::num_words; ++w)
+  {
+    planner.precondMasks.push_back(act.precondMask.words[w]);
+    planner.precondValues.push_back(act.precondition.words[w] & act.precondMask.words[w]);
+  }
+
+  planner.effectActions.resize(planner.wdesc.size());
+  for (size_t i = 0; i < planner.wdesc.size(); ++i)
+    if (act.effect[i] >= 0 || act.additive[i] != 0)
+      planner.effectActions[i].push_back(planner.actions.size());
+
   planner.actionNames.emplace(name, planner.actions.size());
   planner.actions.emplace_back(act);
 }
@@ -33,14 +83,14 @@ static void set_planner_worldstate(const goap::Planner &planner, goap::WorldStat
   auto itf = planner.wdesc.find(st_name);
   if (itf == planner.wdesc.end())
     return;
-  st[itf->second] = val;
+  st.set(itf->second, val);
 }
 
 goap::WorldState goap::produce_planner_worldstate(const Planner &planner, const WorldStateList &states)
 {
   WorldState res;
   for (size_t i = 0; i < planner.wdesc.size(); ++i)
-    res.emplace_back(int8_t(-1));
+    res.push_back(int8_t(-1));
   for (auto st : states)
     set_planner_worldstate(planner, res, st.first, int8_t(st.second));
   return res;
@@ -55,13 +105,13 @@ std::vector<size_t> goap::find_valid_state_transitions(const Planner &planner, c
 {
   std::vector<size_t> res;
 
+  constexpr size_t numWords = WorldState::num_words;
   for (size_t i = 0; i < planner.actions.size(); ++i)
   {
-    const Action &action = planner.actions[i];
-    bool isValidAction = true;
-    for (size_t j = 0; j < action.precondition.size() && isValidAction; ++j)
-      isValidAction &= action.precondition[j] < 0 || from[j] == action.precondition[j];
-    if (isValidAction)
+    uint64_t diff = 0;
+    for (size_t w = 0; w < numWords; ++w)
+      diff |= (from.words[w] & planner.precondMasks[i * numWords + w]) ^ planner.precondValues[i * numWords + w];
+    if (diff == 0)
       res.emplace_back(i);
   }
   return res;
@@ -71,13 +121,13 @@ goap::WorldState goap::apply_action(const Planner &planner, size_t act, const Wo
 {
   WorldState res = from;
   const Action &action = planner.actions[act];
-  for (size_t i = 0; i < action.effect.size(); ++i)
+  for (size_t w = 0; w < WorldState::num_words; ++w)
+    res.words[w] = (from.words[w] & ~action.setMask.words[w]) | (action.effect.words[w] & action.setMask.words[w]);
+  // additive effects saturate at the domain instead of wrapping
+  for (size_t i : action.additiveVars)
   {
-    if (!action.setBitset[i])
-      res[i] += action.effect[i];
-    else if (action.effect[i] >= 0)
-      res[i] = action.effect[i];
+    const int val = int(res[i]) + action.additive[i];
+    res.set(i, int8_t(std::clamp(val, int(planner.domainMin[i]), int(planner.domainMax[i]))));
   }
   return res;
 }
-
@@ -5,15 +5,45 @@
 
 #include "goapWorldState.h"
 #include "goapAction.h"
+#include "goapHeuristic.h"
 
 namespace goap
 {
+  // identifies plans of a planner in caches, copies get their own id as they may be changed independently
+  struct PlannerId
+  {
+    size_t value;
+
+    PlannerId();
+    PlannerId(const PlannerId &) : PlannerId() {}
+    PlannerId(PlannerId &&) = default;
+    PlannerId &operator=(const PlannerId &) { *this = PlannerId(); return *this; }
+    PlannerId &operator=(PlannerId &&) = default;
+  };
 
   struct Planner
   {
+    PlannerId id;
     WorldDesc wdesc;
     std::vector<Action> actions;
     std::unordered_map<std::string, size_t> actionNames;
+
+    // compiled preconditions of all actions side by side, num_words per action, checked in one flat loop
+    std::vector<uint64_t> precondMasks;
+    std::vector<uint64_t> precondValues;
+
+    std::vector<std::vector<size_t>> effectActions; // actions which set or add to each variable
+
+    // inclusive value range of each variable, additive effects saturate at it and states outside are never visited
+    WorldState domainMin;
+    WorldState domainMax;
+
+    // search gives up after expanding this many nodes and skips plans costing more, 0 means no limit
+    size_t maxExpandedNodes = 0;
+    float maxPlanCost = 0.f;
+
+    Heuristic heuristic = heuristic_difference;
+    HeuristicData heuristicData;
   };
 
   Planner create_planner();
@@ -28,6 +58,9 @@ namespace goap
                                                                              const Effect &additive_effect);
 
   void add_states_to_planner(Planner &planner, const std::vector<std::string> &state_names);
+  // states are added with [0, 127] domain, false for unknown state
+  bool set_state_domain(Planner &planner, const char *st_name, int8_t min_val, int8_t max_val);
+  bool is_within_domains(const Planner &planner, const WorldState &ws);
   WorldState produce_planner_worldstate(const Planner &planner, const WorldStateList &states);
 
   float get_action_cost(const Planner &planner, size_t act_id);
@@ -41,7 +74,35 @@ namespace goap
     WorldState worldState;
   };
 
-  float make_plan(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan);
+  struct PlanStats
+  {
+    size_t expandedNodes = 0;
+    size_t generatedNodes = 0;
+  };
+
+  float make_plan(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan,
+                  PlanStats *stats = nullptr);
+  // searches backwards from goal through effects of actions relevant to it, same result format as make_plan
+  // pays off on shallow goals over few variables, long additive chains still expand more than forward search
+  float make_plan_regressive(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan,
+                             PlanStats *stats = nullptr);
+
+  struct PlanRequest
+  {
+    const Planner *planner;
+    WorldState from;
+    WorldState to;
+  };
+
+  struct PlanResult
+  {
+    float cost = 0.f;
+    std::vector<PlanStep> plan;
+  };
+
+  // solves requests on persistent worker threads, results go in order of requests, 0 threads uses all hardware threads
+  void make_plans(const std::vector<PlanRequest> &requests, std::vector<PlanResult> &results, size_t num_threads = 0);
+
   void print_plan(const Planner &planner, const WorldState &init, const std::vector<PlanStep> &plan);
 };
 
@@ -1,11 +1,110 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <vector>
 #include <unordered_map>
 #include <string>
 
 namespace goap
 {
-  using WorldState = std::vector<int8_t>;
+  // fixed capacity state, int8 variables packed into words, unused variables hold -1
+  struct WorldState
+  {
+    static constexpr size_t vars_per_word = 8;
+    static constexpr size_t num_words = 2;
+    static constexpr size_t max_vars = vars_per_word * num_words;
+
+    uint64_t words[num_words] = {~uint64_t(0), ~uint64_t(0)};
+    uint8_t numVars = 0;
+
+    size_t size() const { return numVars; }
+
+    int8_t operator[](size_t i) const
+    {
+      return int8_t(uint8_t(words[i / vars_per_word] >> (i % vars_per_word * 8)));
+    }
+
+    // writing past capacity would corrupt neighbouring state, so it's fatal in every build
+    static void check_capacity(size_t i)
+    {
+      if (i < max_vars)
+        return;
+      fprintf(stderr, "goap: world state holds at most %zu variables, %zu requested\n", max_vars, i + 1);
+      abort();
+    }
+
+    void set(size_t i, int8_t val)
+    {
+      check_capacity(i);
+      const size_t shift = i % vars_per_word * 8;
+      uint64_t &word = words[i / vars_per_word];
+      word = (word & ~(uint64_t(0xff) << shift)) | (uint64_t(uint8_t(val)) << shift);
+    }
+
+    void push_back(int8_t val) { set(numVars++, val); }
+
+    // whole bytes of variables which aren't -1, masks are used for masked comparisons
+    WorldState care_mask() const
+    {
+      WorldState res;
+      res.numVars = numVars;
+      for (size_t i = 0; i < numVars; ++i)
+        res.set(i, (*this)[i] >= 0 ? int8_t(-1) : int8_t(0));
+      for (size_t i = numVars; i < max_vars; ++i)
+        res.set(i, 0);
+      return res;
+    }
+
+    // every variable selected by mask is equal to pattern
+    bool matches(const WorldState &pattern, const WorldState &mask) const
+    {
+      uint64_t diff = 0;
+      for (size_t w = 0; w < num_words; ++w)
+        diff |= (words[w] ^ pattern.words[w]) & mask.words[w];
+      return diff == 0;
+    }
+
+    // variables outside mask become -1, so the result is a goal caring only about masked ones
+    WorldState projected(const WorldState &mask) const
+    {
+      WorldState res;
+      res.numVars = numVars;
+      for (size_t w = 0; w < num_words; ++w)
+        res.words[w] = (words[w] & mask.words[w]) | ~mask.words[w];
+      return res;
+    }
+
+    // every variable selected by mask is selected by other
+    bool mask_within(const WorldState &other) const
+    {
+      uint64_t extra = 0;
+      for (size_t w = 0; w < num_words; ++w)
+        extra |= words[w] & ~other.words[w];
+      return extra == 0;
+    }
+
+    size_t hash() const
+    {
+      uint64_t h = words[0] * 0x9e3779b97f4a7c15ull;
+      for (size_t w = 1; w < num_words; ++w)
+        h = (h ^ (h >> 29) ^ words[w]) * 0xbf58476d1ce4e5b9ull;
+      return h ^ (h >> 32);
+    }
+  };
+
+  inline bool operator==(const WorldState &lhs, const WorldState &rhs)
+  {
+    return lhs.words[0] == rhs.words[0] && lhs.words[1] == rhs.words[1];
+  }
+  inline bool operator!=(const WorldState &lhs, const WorldState &rhs) { return !(lhs == rhs); }
+
   using WorldDesc = std::unordered_map<std::string, size_t>;
 };
 
+template<>
+struct std::hash<goap::WorldState>
+{
+  size_t operator()(const goap::WorldState &ws) const { return ws.hash(); }
+};
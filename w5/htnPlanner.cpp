@@ -0,0 +1,115 @@
+#include "htnPlanner.h"
+#include <cstdio>
+
+htn::Planner htn::create_planner(const goap::Planner &actions)
+{
+  Planner res;
+  res.actions = &actions;
+  return res;
+}
+
+void htn::add_task_to_planner(Planner &planner, const char *name)
+{
+  planner.taskNames.emplace(name, planner.tasks.size());
+  planner.tasks.push_back({name, {}});
+}
+
+bool htn::add_method_to_planner(Planner &planner, const char *task_name, const char *name, const goap::Precond &precond,
+                                const std::vector<std::string> &subtasks)
+{
+  auto itf = planner.taskNames.find(task_name);
+  if (itf == planner.taskNames.end())
+  {
+    fprintf(stderr, "htn: method '%s' of unknown task '%s'\n", name, task_name);
+    return false;
+  }
+  const goap::Planner &actions = *planner.actions;
+  Method method;
+  method.name = name;
+  method.precondition = goap::produce_planner_worldstate(actions, precond);
+  method.precondMask = method.precondition.care_mask();
+  for (const std::string &subtask : subtasks)
+  {
+    auto task = planner.taskNames.find(subtask);
+    if (task != planner.taskNames.end())
+    {
+      method.subtasks.push_back({true, task->second});
+      continue;
+    }
+    auto action = actions.actionNames.find(subtask);
+    if (action == actions.actionNames.end())
+    {
+      fprintf(stderr, "htn: method '%s' uses unknown subtask '%s'\n", name, subtask.c_str());
+      return false;
+    }
+    method.subtasks.push_back({false, action->second});
+  }
+  planner.tasks[itf->second].methods.push_back(std::move(method));
+  return true;
+}
+
+struct Decomposition
+{
+  const htn::Planner &planner;
+  std::vector<goap::PlanStep> &plan;
+  htn::PlanStats stats;
+  float cost = 0.f;
+
+  // agenda holds tasks left to do, next one at the back
+  bool decompose(std::vector<htn::TaskRef> &agenda, const goap::WorldState &ws, size_t depth)
+  {
+    if (agenda.empty())
+      return true;
+    if (depth > planner.maxDepth)
+      return false;
+    const htn::TaskRef task = agenda.back();
+    agenda.pop_back();
+    const goap::Planner &actions = *planner.actions;
+    if (!task.compound)
+    {
+      const goap::Action &action = actions.actions[task.idx];
+      if (ws.matches(action.precondition, action.precondMask))
+      {
+        const goap::WorldState next = goap::apply_action(actions, task.idx, ws);
+        plan.push_back({task.idx, next});
+        cost += action.cost;
+        if (decompose(agenda, next, depth + 1))
+          return true;
+        cost -= action.cost;
+        plan.pop_back();
+      }
+      agenda.push_back(task);
+      return false;
+    }
+    const size_t agendaSize = agenda.size();
+    for (const htn::Method &method : planner.tasks[task.idx].methods)
+    {
+      if (!ws.matches(method.precondition, method.precondMask))
+        continue;
+      stats.decompositions++;
+      agenda.insert(agenda.end(), method.subtasks.rbegin(), method.subtasks.rend());
+      if (decompose(agenda, ws, depth + 1))
+        return true;
+      stats.backtracks++;
+      agenda.resize(agendaSize);
+    }
+    agenda.push_back(task);
+    return false;
+  }
+};
+
+float htn::make_plan(const Planner &planner, const goap::WorldState &from, const char *task_name,
+                     std::vector<goap::PlanStep> &plan, PlanStats *stats)
+{
+  plan.clear();
+  auto itf = planner.taskNames.find(task_name);
+  if (itf == planner.taskNames.end())
+    return 0.f;
+  Decomposition decomposition{planner, plan, {}, 0.f};
+  std::vector<TaskRef> agenda = {{true, itf->second}};
+  if (!decomposition.decompose(agenda, from, 0))
+    plan.clear();
+  if (stats)
+    *stats = decomposition.stats;
+  return plan.empty() ? 0.f : decomposition.cost;
+}
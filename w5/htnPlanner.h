@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "goapPlanner.h"
+
+namespace htn
+{
+  // subtasks are either compound tasks of htn planner or primitive actions of its goap planner
+  struct TaskRef
+  {
+    bool compound;
+    size_t idx;
+  };
+
+  struct Method
+  {
+    std::string name;
+    goap::WorldState precondition;
+    goap::WorldState precondMask;
+    std::vector<TaskRef> subtasks;
+  };
+
+  // methods are tried in order they were added, first one which decomposes fully wins
+  struct CompoundTask
+  {
+    std::string name;
+    std::vector<Method> methods;
+  };
+
+  struct Planner
+  {
+    const goap::Planner *actions = nullptr; // primitive tasks, their preconditions and effects
+    std::vector<CompoundTask> tasks;
+    std::unordered_map<std::string, size_t> taskNames;
+
+    size_t maxDepth = 256; // bounds recursive decompositions which never bottom out
+  };
+
+  struct PlanStats
+  {
+    size_t decompositions = 0;
+    size_t backtracks = 0;
+  };
+
+  Planner create_planner(const goap::Planner &actions);
+
+  // tasks have to be added before methods can refer to them, so recursive tasks are possible
+  void add_task_to_planner(Planner &planner, const char *name);
+  // false and no method is added when task or any subtask is unknown
+  bool add_method_to_planner(Planner &planner, const char *task_name, const char *name, const goap::Precond &precond,
+                             const std::vector<std::string> &subtasks);
+
+  // same plan format as goap::make_plan, returns cost of the plan, empty plan when task can't be decomposed
+  float make_plan(const Planner &planner, const goap::WorldState &from, const char *task_name,
+                  std::vector<goap::PlanStep> &plan, PlanStats *stats = nullptr);
+};
+
@@ -6,6 +6,9 @@
 #include "roguelike.h"
 #include "dungeonGen.h"
 #include "goapPlanner.h"
+#include "goapPlanCache.h"
+#include "goapExecutor.h"
+#include "htnPlanner.h"
 
 enum EnemyDist
 {
@@ -32,6 +35,9 @@ static void debug_enemy_planner()
        "have_ranged",
        "enemy_dist",
        "health_state"});
+  goap::set_state_domain(pl, "enemy_dist", DistMelee, DistFar);
+  goap::set_state_domain(pl, "health_state", Dead, Healthy);
+  pl.maxExpandedNodes = 1000;
 
   goap::add_action_to_planner(pl, "wander", 1,
       {{"health_state", Healthy}},
@@ -105,6 +111,70 @@ static void debug_enemy_planner()
     goap::make_plan(pl, ws, goal, plan);
     goap::print_plan(pl, ws, plan);
   }
+  {
+    // a pack of identical monsters in the same situation plans only once
+    goap::PlanCache cache;
+    goap::WorldState ws = goap::produce_planner_worldstate(pl,
+        {{"enemy_vis", 1},
+         {"enemy_alive", 1},
+         {"have_melee", 1},
+         {"have_ranged", 0},
+         {"enemy_dist", DistFar},
+         {"health_state", Healthy}});
+    goap::WorldState goal = goap::produce_planner_worldstate(pl,
+        {{"enemy_alive", 0}, {"health_state", Healthy}});
+    std::vector<goap::PlanStep> plan;
+    for (int i = 0; i < 4; ++i)
+      goap::make_plan_cached(cache, pl, ws, goal, plan);
+    goap::print_plan(pl, ws, plan);
+    const goap::PlanCacheStats stats = goap::get_cache_stats(cache);
+    printf("plan cache: %zu hits, %zu misses\n", stats.hits, stats.misses);
+
+    // find_ranged sets enemy_dist, so moving enemy doesn't need a new plan, picking up a bow does
+    goap::PlanExecutor exec;
+    goap::set_executor_goal(exec, pl, ws, goal);
+    goap::WorldState sensed = ws;
+    sensed.set(pl.wdesc.at("enemy_dist"), DistRanged);
+    goap::update_executor(exec, pl, sensed);
+    sensed.set(pl.wdesc.at("have_ranged"), 1);
+    goap::update_executor(exec, pl, sensed);
+    goap::print_plan(pl, sensed, exec.plan);
+    printf("executor: %zu replans, %zu validations\n", exec.numReplans, exec.numValidations);
+  }
+  {
+    // a crowd of monsters in different situations plans in one batch on worker threads
+    std::vector<goap::PlanRequest> requests;
+    for (int dist : {DistMelee, DistRanged, DistFar})
+      for (int health : {Injured, Healthy})
+      {
+        goap::WorldState ws = goap::produce_planner_worldstate(pl,
+            {{"enemy_vis", 1},
+             {"enemy_alive", 1},
+             {"have_melee", 1},
+             {"have_ranged", 0},
+             {"enemy_dist", dist},
+             {"health_state", health}});
+        requests.push_back({&pl, ws, goap::produce_planner_worldstate(pl, {{"enemy_alive", 0}})});
+      }
+    std::vector<goap::PlanResult> results;
+    goap::make_plans(requests, results, 4);
+    for (const goap::PlanResult &res : results)
+      printf("batch plan: cost %.0f, %zu steps\n", double(res.cost), res.plan.size());
+  }
+  {
+    // fleeing saturates at DistFar, so unreachable goal fails after a handful of states
+    goap::WorldState ws = goap::produce_planner_worldstate(pl,
+        {{"enemy_vis", 1},
+         {"enemy_alive", 1},
+         {"have_melee", 0},
+         {"have_ranged", 0},
+         {"enemy_dist", DistMelee},
+         {"health_state", Healthy}});
+    goap::WorldState goal = goap::produce_planner_worldstate(pl, {{"enemy_dist", DistFar + 1}});
+    std::vector<goap::PlanStep> plan;
+    goap::make_plan(pl, ws, goal, plan);
+    printf("unreachable goal: %zu steps\n", plan.size());
+  }
 }
 
 static void debug_looter_planner()
@@ -120,6 +190,12 @@ static void debug_looter_planner()
        "enemy_dist",
        "health_state",
        "escaped"});
+  for (const char *flag : {"enemy_vis", "loot_vis", "have_melee", "have_ranged", "escaped"})
+    goap::set_state_domain(pl, flag, 0, 1);
+  goap::set_state_domain(pl, "num_loot", 0, 5);
+  goap::set_state_domain(pl, "enemy_dist", DistMelee, DistFar);
+  goap::set_state_domain(pl, "health_state", Dead, Healthy);
+  pl.maxExpandedNodes = 1000;
 
   goap::add_action_to_planner(pl, "open_room", 1,
       {{"health_state", Healthy}},
@@ -187,6 +263,56 @@ static void debug_looter_planner()
   std::vector<goap::PlanStep> plan;
   goap::make_plan(pl, ws, goal, plan);
   goap::print_plan(pl, ws, plan);
+
+  // goal mentions only a few variables, backward search ignores unrelated actions
+  std::vector<goap::PlanStep> regressivePlan;
+  goap::make_plan_regressive(pl, ws, goal, regressivePlan);
+  goap::print_plan(pl, ws, regressivePlan);
+
+  // admissible heuristics find the cheapest plan, pattern database also knows loot takes a whole room cycle
+  goap::Planner admissible = pl;
+  goap::prepare_heuristic(admissible);
+  goap::Planner patterns = admissible;
+  goap::add_pattern_database(patterns, {"num_loot", "loot_vis", "enemy_vis", "enemy_dist", "health_state"}, goal);
+  for (const goap::Planner *planner : {&pl, &admissible, &patterns})
+  {
+    std::vector<goap::PlanStep> heuristicPlan;
+    goap::PlanStats stats;
+    const float cost = goap::make_plan(*planner, ws, goal, heuristicPlan, &stats);
+    printf("cost %.0f, %zu steps, %zu expanded, %zu generated\n", double(cost), heuristicPlan.size(),
+           stats.expandedNodes, stats.generatedNodes);
+  }
+
+  // same scenario as scripted decomposition over the same actions, no search over states at all
+  htn::Planner htnPl = htn::create_planner(pl);
+  htn::add_task_to_planner(htnPl, "loot_dungeon");
+  htn::add_task_to_planner(htnPl, "loot_room");
+  htn::add_task_to_planner(htnPl, "clear_room");
+  htn::add_task_to_planner(htnPl, "close_in");
+  htn::add_task_to_planner(htnPl, "recover");
+
+  htn::add_method_to_planner(htnPl, "loot_dungeon", "leave", {{"num_loot", 5}}, {"escape"});
+  htn::add_method_to_planner(htnPl, "loot_dungeon", "next_room", {}, {"loot_room", "loot_dungeon"});
+
+  htn::add_method_to_planner(htnPl, "loot_room", "take", {{"loot_vis", 1}, {"enemy_vis", 0}}, {"loot"});
+  htn::add_method_to_planner(htnPl, "loot_room", "fight", {{"enemy_vis", 1}}, {"clear_room", "loot_room"});
+  htn::add_method_to_planner(htnPl, "loot_room", "explore", {{"loot_vis", 0}}, {"open_room", "loot_room"});
+
+  htn::add_method_to_planner(htnPl, "clear_room", "melee", {{"have_melee", 1}}, {"close_in", "attack_enemy", "recover"});
+  htn::add_method_to_planner(htnPl, "clear_room", "ranged", {{"have_ranged", 1}}, {"shoot_enemy", "recover"});
+
+  htn::add_method_to_planner(htnPl, "close_in", "in_reach", {{"enemy_dist", DistMelee}}, {});
+  htn::add_method_to_planner(htnPl, "close_in", "step", {}, {"approach_enemy", "close_in"});
+
+  htn::add_method_to_planner(htnPl, "recover", "healthy", {{"health_state", Healthy}}, {});
+  htn::add_method_to_planner(htnPl, "recover", "heal", {}, {"patch_up", "recover"});
+
+  std::vector<goap::PlanStep> htnPlan;
+  htn::PlanStats htnStats;
+  const float htnCost = htn::make_plan(htnPl, ws, "loot_dungeon", htnPlan, &htnStats);
+  goap::print_plan(pl, ws, htnPlan);
+  printf("htn cost %.0f, %zu steps, %zu decompositions, %zu backtracks\n", double(htnCost), htnPlan.size(),
+         htnStats.decompositions, htnStats.backtracks);
 }
 
 
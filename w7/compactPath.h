@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include "math.h"
+
+// 4-connected tile path stored as start tile and 2-bit step directions, 32 steps per word
+struct CompactPath
+{
+  enum Dir : uint8_t
+  {
+    DIR_RIGHT = 0,
+    DIR_LEFT,
+    DIR_DOWN,
+    DIR_UP
+  };
+  static constexpr size_t steps_per_word = 32;
+
+  IVec2 start{-1, -1};
+  size_t numSteps = 0;
+  bool valid = false; // path of a single tile has no steps but isn't empty
+  std::vector<uint64_t> words;
+
+  static IVec2 step_offset(uint8_t dir)
+  {
+    return dir == DIR_RIGHT ? IVec2{1, 0} :
+           dir == DIR_LEFT ? IVec2{-1, 0} :
+           dir == DIR_DOWN ? IVec2{0, 1} : IVec2{0, -1};
+  }
+
+  static uint8_t step_dir(IVec2 from, IVec2 to)
+  {
+    return to.x > from.x ? DIR_RIGHT :
+           to.x < from.x ? DIR_LEFT :
+           to.y > from.y ? DIR_DOWN : DIR_UP;
+  }
+
+  // steps are written by index so path can be filled from its end
+  void resize(size_t num_steps)
+  {
+    numSteps = num_steps;
+    words.assign((num_steps + steps_per_word - 1) / steps_per_word, 0);
+    valid = true;
+  }
+
+  void set_step(size_t i, uint8_t dir)
+  {
+    const size_t shift = (i % steps_per_word) * 2;
+    uint64_t &word = words[i / steps_per_word];
+    word = (word & ~(uint64_t(3) << shift)) | (uint64_t(dir) << shift);
+  }
+
+  uint8_t get_step(size_t i) const
+  {
+    return uint8_t((words[i / steps_per_word] >> ((i % steps_per_word) * 2)) & 3);
+  }
+
+  // number of tiles in the path, start included
+  size_t size() const { return valid ? numSteps + 1 : 0; }
+  bool empty() const { return !valid; }
+
+  class iterator
+  {
+    const CompactPath *path = nullptr;
+    size_t step = 0;
+    IVec2 pos{0, 0};
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = IVec2;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const IVec2*;
+    using reference = const IVec2&;
+
+    iterator() = default;
+    iterator(const CompactPath *p, size_t s, IVec2 start) : path(p), step(s), pos(start) {}
+
+    const IVec2 &operator*() const { return pos; }
+    const IVec2 *operator->() const { return &pos; }
+    iterator &operator++()
+    {
+      if (step < path->numSteps)
+      {
+        const IVec2 offs = step_offset(path->get_step(step));
+        pos = IVec2{pos.x + offs.x, pos.y + offs.y};
+      }
+      ++step;
+      return *this;
+    }
+    iterator operator++(int) { iterator res = *this; ++*this; return res; }
+    bool operator==(const iterator &rhs) const { return step == rhs.step; }
+    bool operator!=(const iterator &rhs) const { return step != rhs.step; }
+  };
+
+  iterator begin() const { return iterator(this, 0, start); }
+  iterator end() const { return iterator(this, size(), start); }
+};
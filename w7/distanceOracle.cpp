@@ -0,0 +1,161 @@
+#include "distanceOracle.h"
+#include "dungeonUtils.h"
+#include <algorithm>
+#include <queue>
+
+static IVec2 cluster_origin(size_t per_row, size_t cluster)
+{
+  return IVec2{int(cluster % per_row * pathfinder::splitTiles), int(cluster / per_row * pathfinder::splitTiles)};
+}
+
+// bfs limited to one cluster, dist holds splitTiles * splitTiles local values
+static void cluster_bfs(const DungeonData &dd, IVec2 origin, size_t from, std::vector<float> &dist)
+{
+  constexpr size_t split = pathfinder::splitTiles;
+  dist.assign(split * split, oracle::invalid_dist);
+  dist[from] = 0.f;
+  std::queue<size_t> openList;
+  openList.push(from);
+  while (!openList.empty())
+  {
+    const size_t idx = openList.front();
+    openList.pop();
+    const int x = int(idx % split);
+    const int y = int(idx / split);
+    auto checkNeighbour = [&](int nx, int ny)
+    {
+      if (nx < 0 || ny < 0 || nx >= int(split) || ny >= int(split))
+        return;
+      if (dd.tiles[size_t(origin.y + ny) * dd.width + size_t(origin.x + nx)] == dungeon::wall)
+        return;
+      const size_t nidx = size_t(ny) * split + size_t(nx);
+      if (dist[nidx] < oracle::invalid_dist)
+        return;
+      dist[nidx] = dist[idx] + 1.f;
+      openList.push(nidx);
+    };
+    checkNeighbour(x + 1, y);
+    checkNeighbour(x - 1, y);
+    checkNeighbour(x, y + 1);
+    checkNeighbour(x, y - 1);
+  }
+}
+
+DistanceOracle oracle::build(const DungeonData &dd)
+{
+  constexpr size_t split = pathfinder::splitTiles;
+  const size_t perRow = dd.width / split;
+  const size_t perColumn = dd.height / split;
+  DistanceOracle res;
+  res.width = dd.width;
+  res.tileNode.assign(dd.width * dd.height, no_node);
+  res.tileOffset.assign(dd.width * dd.height, invalid_dist);
+
+  std::vector<size_t> nodeRepr; // tile index of each representative
+  std::vector<float> dist;
+  for (size_t cluster = 0; cluster < perRow * perColumn; ++cluster)
+  {
+    const IVec2 origin = cluster_origin(perRow, cluster);
+    auto tileIdx = [&](size_t local) { return size_t(origin.y) * dd.width + size_t(origin.x) + local / split * dd.width + local % split; };
+    for (size_t local = 0; local < split * split; ++local)
+    {
+      if (dd.tiles[tileIdx(local)] == dungeon::wall || res.tileNode[tileIdx(local)] != no_node)
+        continue;
+      // connected part of the cluster, its representative is the tile closest to its centroid
+      cluster_bfs(dd, origin, local, dist);
+      float cx = 0.f, cy = 0.f, count = 0.f;
+      for (size_t i = 0; i < dist.size(); ++i)
+        if (dist[i] < invalid_dist)
+        {
+          cx += float(i % split);
+          cy += float(i / split);
+          count += 1.f;
+        }
+      size_t repr = local;
+      float bestDistSq = invalid_dist;
+      for (size_t i = 0; i < dist.size(); ++i)
+        if (dist[i] < invalid_dist)
+        {
+          const float dsq = sqr(float(i % split) - cx / count) + sqr(float(i / split) - cy / count);
+          if (dsq < bestDistSq)
+          {
+            bestDistSq = dsq;
+            repr = i;
+          }
+        }
+      cluster_bfs(dd, origin, repr, dist);
+      const uint32_t node = uint32_t(nodeRepr.size());
+      nodeRepr.push_back(tileIdx(repr));
+      for (size_t i = 0; i < dist.size(); ++i)
+        if (dist[i] < invalid_dist)
+        {
+          res.tileNode[tileIdx(i)] = node;
+          res.tileOffset[tileIdx(i)] = dist[i];
+        }
+    }
+  }
+
+  // bfs over the whole dungeon from every representative, paths may leave clusters of both nodes
+  res.numNodes = nodeRepr.size();
+  res.nodeDist.assign(res.numNodes * res.numNodes, invalid_dist);
+  std::vector<float> tileDist;
+  for (size_t from = 0; from < res.numNodes; ++from)
+  {
+    tileDist.assign(dd.width * dd.height, invalid_dist);
+    tileDist[nodeRepr[from]] = 0.f;
+    std::queue<size_t> openList;
+    openList.push(nodeRepr[from]);
+    while (!openList.empty())
+    {
+      const size_t idx = openList.front();
+      openList.pop();
+      const size_t x = idx % dd.width;
+      const size_t y = idx / dd.width;
+      auto checkNeighbour = [&](size_t nidx)
+      {
+        if (dd.tiles[nidx] == dungeon::wall || tileDist[nidx] < invalid_dist)
+          return;
+        tileDist[nidx] = tileDist[idx] + 1.f;
+        openList.push(nidx);
+      };
+      if (x + 1 < dd.width)
+        checkNeighbour(idx + 1);
+      if (x > 0)
+        checkNeighbour(idx - 1);
+      if (y + 1 < dd.height)
+        checkNeighbour(idx + dd.width);
+      if (y > 0)
+        checkNeighbour(idx - dd.width);
+    }
+    for (size_t to = 0; to < res.numNodes; ++to)
+      res.nodeDist[from * res.numNodes + to] = tileDist[nodeRepr[to]];
+  }
+  return res;
+}
+
+static bool tile_node(const DistanceOracle &oracle, IVec2 p, size_t &idx)
+{
+  if (p.x < 0 || p.y < 0 || size_t(p.x) >= oracle.width)
+    return false;
+  idx = size_t(p.y) * oracle.width + size_t(p.x);
+  return idx < oracle.tileNode.size() && oracle.tileNode[idx] != oracle::no_node;
+}
+
+float oracle::estimate(const DistanceOracle &oracle, IVec2 from, IVec2 to)
+{
+  size_t fromIdx = 0, toIdx = 0;
+  if (!tile_node(oracle, from, fromIdx) || !tile_node(oracle, to, toIdx))
+    return invalid_dist;
+  const float between = oracle.nodeDist[size_t(oracle.tileNode[fromIdx]) * oracle.numNodes + oracle.tileNode[toIdx]];
+  if (between >= invalid_dist)
+    return invalid_dist;
+  return oracle.tileOffset[fromIdx] + between + oracle.tileOffset[toIdx];
+}
+
+float oracle::error_bound(const DistanceOracle &oracle, IVec2 from, IVec2 to)
+{
+  size_t fromIdx = 0, toIdx = 0;
+  if (!tile_node(oracle, from, fromIdx) || !tile_node(oracle, to, toIdx))
+    return invalid_dist;
+  return 2.f * (oracle.tileOffset[fromIdx] + oracle.tileOffset[toIdx]);
+}
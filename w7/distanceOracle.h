@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "math.h"
+#include "ecsTypes.h"
+#include "pathfinder.h"
+
+// O(1) approximate path distance, every connected part of a cluster is a node with a representative tile,
+// estimate is offset(from) + exact distance between representatives + offset(to)
+// memory is O(tiles + nodes^2), nodeDist holds every pair of nodes
+struct DistanceOracle
+{
+  size_t width = 0;
+  size_t numNodes = 0;
+  std::vector<uint32_t> tileNode; // node of each tile, no_node for walls and tiles outside of clusters
+  std::vector<float> tileOffset; // distance inside of the cluster from tile to its node representative
+  std::vector<float> nodeDist; // numNodes * numNodes, between representatives
+};
+
+namespace oracle
+{
+  constexpr uint32_t no_node = uint32_t(-1);
+  constexpr float invalid_dist = 1e5f;
+
+  DistanceOracle build(const DungeonData &dd);
+
+  // invalid_dist if either tile is a wall or tiles aren't connected
+  float estimate(const DistanceOracle &oracle, IVec2 from, IVec2 to);
+  // by triangle inequality real distance differs from representatives distance by at most offset(from) + offset(to),
+  // so real <= estimate <= real + 2 * (offset(from) + offset(to))
+  float error_bound(const DistanceOracle &oracle, IVec2 from, IVec2 to);
+};
@@ -1,5 +1,6 @@
 #include "dungeonUtils.h"
 #include "raylib.h"
+#include <algorithm>
 
 Position dungeon::find_walkable_tile(flecs::world &ecs)
 {
@@ -35,3 +36,21 @@ bool dungeon::is_tile_walkable(flecs::world &ecs, Position pos)
   return res;
 }
 
+
+void dungeon::compute_clearance(DungeonData &dd)
+{
+  // square at tile is one more than the smallest of squares right, below and diagonally from it
+  dd.clearance.assign(dd.width * dd.height, 0);
+  auto clearanceAt = [&](size_t x, size_t y) -> int
+  {
+    return x < dd.width && y < dd.height ? dd.clearance[y * dd.width + x] : 0;
+  };
+  for (size_t y = dd.height; y-- > 0;)
+    for (size_t x = dd.width; x-- > 0;)
+    {
+      if (dd.tiles[y * dd.width + x] == dungeon::wall)
+        continue;
+      const int side = 1 + std::min({clearanceAt(x + 1, y), clearanceAt(x, y + 1), clearanceAt(x + 1, y + 1)});
+      dd.clearance[y * dd.width + x] = uint8_t(std::min(side, 255));
+    }
+}
@@ -9,4 +9,5 @@ namespace dungeon
 
   Position find_walkable_tile(flecs::world &ecs);
   bool is_tile_walkable(flecs::world &ecs, Position pos);
+  void compute_clearance(DungeonData &dd);
 };
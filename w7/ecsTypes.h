@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -136,6 +137,9 @@ struct Symbol
 
 struct IsPlayer {};
 
+// walks down hierarchical dijkstra map towards the player
+struct HdmapFollower {};
+
 struct WorldInfoGatherer {};
 
 struct Team
@@ -163,6 +167,7 @@ struct DungeonData
   std::vector<char> tiles; // for pathfinding
   size_t width;
   size_t height;
+  std::vector<uint8_t> clearance; // side of largest free square with top left corner at tile
 };
 
 struct DijkstraMapData
@@ -0,0 +1,239 @@
+#include "hierarchicalDmap.h"
+#include "dungeonUtils.h"
+#include <algorithm>
+#include <queue>
+
+static size_t clusters_per_row(const DungeonData &dd)
+{
+  return dd.width / pathfinder::splitTiles;
+}
+
+static size_t clusters_per_column(const DungeonData &dd)
+{
+  return dd.height / pathfinder::splitTiles;
+}
+
+static bool in_clusters(const DungeonData &dd, IVec2 p)
+{
+  return p.x >= 0 && p.y >= 0 &&
+         size_t(p.x) < clusters_per_row(dd) * pathfinder::splitTiles &&
+         size_t(p.y) < clusters_per_column(dd) * pathfinder::splitTiles;
+}
+
+static IVec2 cluster_origin(const DungeonData &dd, size_t cluster)
+{
+  const size_t perRow = clusters_per_row(dd);
+  return IVec2{int(cluster % perRow * pathfinder::splitTiles), int(cluster / perRow * pathfinder::splitTiles)};
+}
+
+// dijkstra limited to one cluster, seeds are local indices with starting values
+static void propagate_cluster(const DungeonData &dd, size_t cluster, std::vector<float> &dist)
+{
+  constexpr size_t split = pathfinder::splitTiles;
+  const IVec2 origin = cluster_origin(dd, cluster);
+  using QueueItem = std::pair<float, size_t>;
+  std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> openList;
+  for (size_t i = 0; i < dist.size(); ++i)
+    if (dist[i] < hdmap::invalid_tile_value)
+      openList.push({dist[i], i});
+  while (!openList.empty())
+  {
+    auto [curDist, idx] = openList.top();
+    openList.pop();
+    if (curDist > dist[idx])
+      continue;
+    const int x = int(idx % split);
+    const int y = int(idx / split);
+    auto checkNeighbour = [&](int nx, int ny)
+    {
+      if (nx < 0 || ny < 0 || nx >= int(split) || ny >= int(split))
+        return;
+      const size_t tileIdx = size_t(origin.y + ny) * dd.width + size_t(origin.x + nx);
+      if (dd.tiles[tileIdx] == dungeon::wall)
+        return;
+      const size_t nidx = size_t(ny) * split + size_t(nx);
+      if (curDist + 1.f < dist[nidx])
+      {
+        dist[nidx] = curDist + 1.f;
+        openList.push({dist[nidx], nidx});
+      }
+    };
+    checkNeighbour(x + 1, y);
+    checkNeighbour(x - 1, y);
+    checkNeighbour(x, y + 1);
+    checkNeighbour(x, y - 1);
+  }
+}
+
+static size_t local_idx(const DungeonData &dd, size_t cluster, size_t tile)
+{
+  const IVec2 origin = cluster_origin(dd, cluster);
+  return (tile / dd.width - size_t(origin.y)) * pathfinder::splitTiles + (tile % dd.width - size_t(origin.x));
+}
+
+static void seed_goals(const HierarchicalDmap &hd, const DungeonData &dd, size_t cluster, std::vector<float> &dist)
+{
+  constexpr size_t split = pathfinder::splitTiles;
+  const IVec2 origin = cluster_origin(dd, cluster);
+  for (const IVec2 &goal : hd.goals)
+    if (in_clusters(dd, goal) && coord_to_tile_idx(goal.x, goal.y, dd.width) == cluster)
+      dist[size_t(goal.y - origin.y) * split + size_t(goal.x - origin.x)] = 0.f;
+}
+
+static std::vector<float> &build_cluster(HierarchicalDmap &hd, const DungeonData &dd, size_t cluster)
+{
+  constexpr size_t split = pathfinder::splitTiles;
+  std::vector<float> &dist = hd.clusters[cluster];
+  dist.assign(split * split, hdmap::invalid_tile_value);
+  seed_goals(hd, dd, cluster, dist);
+  // border tiles already know their exact distance from the coarse level
+  for (size_t node : hd.clusterBorders[cluster])
+  {
+    const size_t idx = local_idx(dd, cluster, hd.borderTiles[node]);
+    dist[idx] = std::min(dist[idx], hd.borderDist[node]);
+  }
+  propagate_cluster(dd, cluster, dist);
+  return dist;
+}
+
+HierarchicalDmap hdmap::create(const DungeonData &dd, const DungeonPortals &dp)
+{
+  constexpr size_t split = pathfinder::splitTiles;
+  HierarchicalDmap hd;
+  hd.clusterBorders.resize(clusters_per_row(dd) * clusters_per_column(dd));
+  std::unordered_map<size_t, size_t> tileNodes;
+  auto get_node = [&](size_t tile)
+  {
+    auto itf = tileNodes.find(tile);
+    if (itf != tileNodes.end())
+      return itf->second;
+    const size_t node = hd.borderTiles.size();
+    hd.borderTiles.push_back(tile);
+    hd.borderEdges.emplace_back();
+    hd.clusterBorders[coord_to_tile_idx(tile % dd.width, tile / dd.width, dd.width)].push_back(node);
+    tileNodes.emplace(tile, node);
+    return node;
+  };
+  // portal spans a row or a column on both sides of a border, every tile is paired with its neighbour across it
+  for (const PathPortal &portal : dp.portals)
+    for (size_t y = portal.startY; y <= portal.endY; ++y)
+      for (size_t x = portal.startX; x <= portal.endX; ++x)
+      {
+        const size_t cluster = coord_to_tile_idx(x, y, dd.width);
+        auto cross = [&](size_t nx, size_t ny)
+        {
+          if (nx > portal.endX || ny > portal.endY || coord_to_tile_idx(nx, ny, dd.width) == cluster)
+            return;
+          const size_t from = get_node(y * dd.width + x);
+          const size_t to = get_node(ny * dd.width + nx);
+          hd.borderEdges[from].emplace_back(to, 1.f);
+          hd.borderEdges[to].emplace_back(from, 1.f);
+        };
+        cross(x + 1, y);
+        cross(x, y + 1);
+      }
+  // paths between border tiles of the same cluster
+  std::vector<float> dist;
+  for (size_t cluster = 0; cluster < hd.clusterBorders.size(); ++cluster)
+    for (size_t from : hd.clusterBorders[cluster])
+    {
+      dist.assign(split * split, invalid_tile_value);
+      dist[local_idx(dd, cluster, hd.borderTiles[from])] = 0.f;
+      propagate_cluster(dd, cluster, dist);
+      for (size_t to : hd.clusterBorders[cluster])
+      {
+        const float d = dist[local_idx(dd, cluster, hd.borderTiles[to])];
+        if (to != from && d < invalid_tile_value)
+          hd.borderEdges[from].emplace_back(to, d);
+      }
+    }
+  return hd;
+}
+
+void hdmap::set_goals(HierarchicalDmap &hd, const DungeonData &dd, const std::vector<IVec2> &goals)
+{
+  constexpr size_t split = pathfinder::splitTiles;
+  hd.goals = goals;
+  hd.clusters.clear();
+  hd.borderDist.assign(hd.borderTiles.size(), invalid_tile_value);
+
+  // goal clusters give initial distances for their own border tiles
+  std::vector<size_t> goalClusters;
+  for (const IVec2 &goal : goals)
+    if (in_clusters(dd, goal))
+      goalClusters.push_back(coord_to_tile_idx(goal.x, goal.y, dd.width));
+  std::sort(goalClusters.begin(), goalClusters.end());
+  goalClusters.erase(std::unique(goalClusters.begin(), goalClusters.end()), goalClusters.end());
+
+  using QueueItem = std::pair<float, size_t>;
+  std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> openList;
+  std::vector<float> dist;
+  for (size_t cluster : goalClusters)
+  {
+    dist.assign(split * split, invalid_tile_value);
+    seed_goals(hd, dd, cluster, dist);
+    propagate_cluster(dd, cluster, dist);
+    for (size_t node : hd.clusterBorders[cluster])
+    {
+      hd.borderDist[node] = dist[local_idx(dd, cluster, hd.borderTiles[node])];
+      if (hd.borderDist[node] < invalid_tile_value)
+        openList.push({hd.borderDist[node], node});
+    }
+  }
+
+  while (!openList.empty())
+  {
+    auto [curDist, node] = openList.top();
+    openList.pop();
+    if (curDist > hd.borderDist[node])
+      continue;
+    for (const auto &[next, cost] : hd.borderEdges[node])
+      if (curDist + cost < hd.borderDist[next])
+      {
+        hd.borderDist[next] = curDist + cost;
+        openList.push({hd.borderDist[next], next});
+      }
+  }
+}
+
+void hdmap::update_active(HierarchicalDmap &hd, const DungeonData &dd, const std::vector<IVec2> &agents)
+{
+  const int perRow = int(clusters_per_row(dd));
+  const int perColumn = int(clusters_per_column(dd));
+  std::vector<size_t> active;
+  for (const IVec2 &agent : agents)
+  {
+    if (!in_clusters(dd, agent))
+      continue;
+    const int cx = agent.x / int(pathfinder::splitTiles);
+    const int cy = agent.y / int(pathfinder::splitTiles);
+    for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, perColumn - 1); ++y)
+      for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, perRow - 1); ++x)
+        active.push_back(size_t(y * perRow + x));
+  }
+  std::sort(active.begin(), active.end());
+  active.erase(std::unique(active.begin(), active.end()), active.end());
+
+  for (auto it = hd.clusters.begin(); it != hd.clusters.end();)
+  {
+    if (!std::binary_search(active.begin(), active.end(), it->first))
+      it = hd.clusters.erase(it);
+    else
+      ++it;
+  }
+  for (size_t cluster : active)
+    if (hd.clusters.find(cluster) == hd.clusters.end())
+      build_cluster(hd, dd, cluster);
+}
+
+float hdmap::get(HierarchicalDmap &hd, const DungeonData &dd, IVec2 p)
+{
+  if (!in_clusters(dd, p))
+    return invalid_tile_value;
+  constexpr size_t split = pathfinder::splitTiles;
+  const size_t cluster = coord_to_tile_idx(p.x, p.y, dd.width);
+  auto itf = hd.clusters.find(cluster);
+  const std::vector<float> &dist = itf != hd.clusters.end() ? itf->second : build_cluster(hd, dd, cluster);
+  const IVec2 origin = cluster_origin(dd, cluster);
+  return dist[size_t(p.y - origin.y) * split + size_t(p.x - origin.x)];
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "math.h"
+#include "ecsTypes.h"
+#include "pathfinder.h"
+
+// two level dijkstra map: coarse distances for tiles at passable cluster borders, fine distances only for active clusters
+struct HierarchicalDmap
+{
+  std::vector<IVec2> goals;
+
+  // coarse level, tiles of portals are nodes, edges cross borders or go through one cluster
+  std::vector<size_t> borderTiles;
+  std::vector<std::vector<std::pair<size_t, float>>> borderEdges;
+  std::vector<std::vector<size_t>> clusterBorders; // nodes of each cluster
+  std::vector<float> borderDist;
+
+  std::unordered_map<size_t, std::vector<float>> clusters; // splitTiles * splitTiles values per cluster
+};
+
+namespace hdmap
+{
+  constexpr float invalid_tile_value = 1e5f;
+
+  // coarse graph depends only on the dungeon, goals can be changed any number of times afterwards
+  HierarchicalDmap create(const DungeonData &dd, const DungeonPortals &dp);
+  // rebuilds coarse level, drops all fine clusters
+  void set_goals(HierarchicalDmap &hd, const DungeonData &dd, const std::vector<IVec2> &goals);
+  // keeps fine level only for clusters around agents (and their neighbours), builds missing ones
+  void update_active(HierarchicalDmap &hd, const DungeonData &dd, const std::vector<IVec2> &agents);
+  // distance to closest goal, cluster is built on demand if it's not active
+  float get(HierarchicalDmap &hd, const DungeonData &dd, IVec2 p);
+};
@@ -7,6 +7,7 @@
 #include "dungeonGen.h"
 #include "math.h"
 #include "pathfinder.h"
+#include "distanceOracle.h"
 
 static void update_camera(flecs::world &ecs)
 {
@@ -66,12 +67,16 @@ int main(int /*argc*/, const char ** /*argv*/)
   IVec2 from { -1, -1 };
   IVec2 to { -1, -1 };
   std::vector<PortalConnection> path;
+  float estimatedDist = oracle::invalid_dist;
+  float estimateError = 0.f;
+  size_t agentSize = 1; // footprint of debug path, keys 1..maxAgentSize
 
   SetTargetFPS(60);               // Set our game to run at 60 frames-per-second
   while (!WindowShouldClose())
   {
     static auto cameraQuery = ecs.query<Camera2D>();
     static auto pathfinderQuery = ecs.query<const DungeonData, const DungeonPortals>();
+    static auto oracleQuery = ecs.query<const DistanceOracle>();
     auto pathfindingProcess = [&]()
     {
       pathfinderQuery.each([&](const DungeonData &dd, const DungeonPortals &dp)
@@ -84,17 +89,17 @@ int main(int /*argc*/, const char ** /*argv*/)
           size_t toIdx = coord_to_tile_idx(mapTo.x, mapTo.y, dd.width);
           if (fromIdx == toIdx)
           {
-            path = find_path_a_star_tiled(dd, dp, mapFrom, mapTo);
+            path = find_path_a_star_tiled(dd, dp, mapFrom, mapTo, agentSize);
             size_t splitTiles = pathfinder::splitTiles;
             size_t tilePerRow = dd.width / splitTiles;
             size_t row = fromIdx / tilePerRow;
             size_t col = fromIdx % tilePerRow;
             IVec2 limMin{ int((col + 0) * splitTiles), int((row + 0) * splitTiles) };
             IVec2 limMax{ int((col + 1) * splitTiles), int((row + 1) * splitTiles) };
-            auto pathSimple = find_path_a_star(dd, mapFrom, mapTo, limMin, limMax);
+            auto pathSimple = find_path_a_star(dd, mapFrom, mapTo, limMin, limMax, agentSize);
             if (pathSimple.empty())
             {
-              path = find_path_a_star_tiled(dd, dp, mapFrom, mapTo);
+              path = find_path_a_star_tiled(dd, dp, mapFrom, mapTo, agentSize);
             }
             else
             {
@@ -104,8 +109,13 @@ int main(int /*argc*/, const char ** /*argv*/)
           }
           else
           {
-            path = find_path_a_star_tiled(dd, dp, mapFrom, mapTo);
+            path = find_path_a_star_tiled(dd, dp, mapFrom, mapTo, agentSize);
           }
+          oracleQuery.each([&](const DistanceOracle &oracle)
+          {
+            estimatedDist = oracle::estimate(oracle, mapFrom, mapTo);
+            estimateError = oracle::error_bound(oracle, mapFrom, mapTo);
+          });
         }
       });
     };
@@ -125,6 +135,12 @@ int main(int /*argc*/, const char ** /*argv*/)
       to = { (int)p.x, (int)p.y };
       pathfindingProcess();
     }
+    for (size_t size = 1; size <= pathfinder::maxAgentSize; ++size)
+      if (IsKeyPressed(KEY_ZERO + int(size)) && agentSize != size)
+      {
+        agentSize = size;
+        pathfindingProcess();
+      }
 
     BeginDrawing();
       ClearBackground(BLACK);
@@ -135,13 +151,13 @@ int main(int /*argc*/, const char ** /*argv*/)
         if (from != IVec2{ -1, -1 })
         {
           Vector2 tileFromPos{ (from.x / (int)tile_size) * tile_size, (from.y / (int)tile_size) * tile_size };
-          Rectangle fromRect{ tileFromPos.x, tileFromPos.y, tile_size, tile_size };
+          Rectangle fromRect{ tileFromPos.x, tileFromPos.y, tile_size * float(agentSize), tile_size * float(agentSize) };
           DrawRectangleLinesEx(fromRect, 5, BLUE);
         }
         if (to != IVec2{ -1, -1 })
         {
           Vector2 tileToPos{ (to.x / (int)tile_size) * tile_size, (to.y / (int)tile_size) * tile_size };
-          Rectangle toRect{ tileToPos.x, tileToPos.y, tile_size, tile_size };
+          Rectangle toRect{ tileToPos.x, tileToPos.y, tile_size * float(agentSize), tile_size * float(agentSize) };
           DrawRectangleLinesEx(toRect, 5, BLUE);
         }
         if (path.size() == 1 && path[0].connIdx == size_t(-1))
@@ -196,6 +212,10 @@ int main(int /*argc*/, const char ** /*argv*/)
           
         }
       EndMode2D();
+      DrawText(TextFormat("agent size: %d", int(agentSize)), 20, 45, 20, WHITE);
+      if (estimatedDist < oracle::invalid_dist)
+        DrawText(TextFormat("estimate: %d (real %d..%d)", int(estimatedDist), int(estimatedDist - estimateError),
+                            int(estimatedDist)), 20, 20, 20, WHITE);
       // Advance to next frame. Process submitted rendering primitives.
     EndDrawing();
   }
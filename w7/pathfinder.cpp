@@ -1,5 +1,7 @@
 #include "pathfinder.h"
 #include "dungeonUtils.h"
+#include "distanceOracle.h"
+#include "hierarchicalDmap.h"
 #include <algorithm>
 
 float heuristic(IVec2 lhs, IVec2 rhs)
@@ -13,19 +15,37 @@ static size_t coord_to_idx(T x, T y, size_t w)
   return size_t(y) * w + size_t(x);
 }
 
-static std::vector<IVec2> reconstruct_path(std::vector<IVec2> prev, IVec2 to, size_t width)
+static bool is_fitting(const DungeonData &dd, size_t idx, size_t agent_size)
 {
+  if (dd.clearance.empty())
+    return agent_size <= 1 && dd.tiles[idx] != dungeon::wall;
+  return dd.clearance[idx] >= agent_size;
+}
+
+// counts steps first, then writes them from the end, linear in path length
+static CompactPath reconstruct_path(const std::vector<IVec2> &prev, IVec2 to, size_t width)
+{
+  size_t numSteps = 0;
   IVec2 curPos = to;
-  std::vector<IVec2> res = {curPos};
   while (prev[coord_to_idx(curPos.x, curPos.y, width)] != IVec2{-1, -1})
   {
     curPos = prev[coord_to_idx(curPos.x, curPos.y, width)];
-    res.insert(res.begin(), curPos);
+    ++numSteps;
+  }
+  CompactPath res;
+  res.start = curPos;
+  res.resize(numSteps);
+  curPos = to;
+  for (size_t i = numSteps; i > 0; --i)
+  {
+    const IVec2 prevPos = prev[coord_to_idx(curPos.x, curPos.y, width)];
+    res.set_step(i - 1, CompactPath::step_dir(prevPos, curPos));
+    curPos = prevPos;
   }
   return res;
 }
 
-static std::vector<PortalConnection> reconstruct_path(const DungeonPortals &dp, std::vector<size_t> prev)
+static std::vector<PortalConnection> reconstruct_path(const DungeonPortals &dp, std::vector<size_t> prev, size_t agent_size)
 {
   std::vector<PortalConnection> res;
   size_t curPos = dp.portals.size();
@@ -34,16 +54,17 @@ static std::vector<PortalConnection> reconstruct_path(const DungeonPortals &dp,
     size_t nextPos = prev[curPos];
     if (nextPos == dp.portals.size() + 1)
       std::swap(nextPos, curPos);
-    for (const auto pc : dp.portals[nextPos].conns)
+    // shortest of connections this agent fits in
+    const PortalConnection *best = nullptr;
+    for (const PortalConnection &pc : dp.portals[nextPos].conns)
+      if (pc.connIdx == curPos && pc.clearance >= agent_size && (!best || pc.score < best->score))
+        best = &pc;
+    if (best)
     {
-      if (pc.connIdx == curPos)
-      {
-        if (curPos == dp.portals.size() + 1)
-          res.insert(res.begin(), {nextPos, pc.score});
-        else
-          res.insert(res.begin(), pc);
-        break;
-      }
+      if (curPos == dp.portals.size() + 1)
+        res.insert(res.begin(), {nextPos, best->score, best->clearance});
+      else
+        res.insert(res.begin(), *best);
     }
     if (curPos == dp.portals.size() + 1)
       std::swap(nextPos, curPos);
@@ -53,11 +74,11 @@ static std::vector<PortalConnection> reconstruct_path(const DungeonPortals &dp,
   return res;
 }
 
-std::vector<IVec2> find_path_a_star(const DungeonData &dd, IVec2 from, IVec2 to,
-                                           IVec2 lim_min, IVec2 lim_max)
+CompactPath find_path_a_star(const DungeonData &dd, IVec2 from, IVec2 to,
+                            IVec2 lim_min, IVec2 lim_max, size_t agent_size)
 {
   if (from.x < 0 || from.y < 0 || from.x >= int(dd.width) || from.y >= int(dd.height))
-    return std::vector<IVec2>();
+    return CompactPath();
   size_t inpSize = dd.width * dd.height;
 
   std::vector<float> g(inpSize, std::numeric_limits<float>::max());
@@ -100,8 +121,8 @@ std::vector<IVec2> find_path_a_star(const DungeonData &dd, IVec2 from, IVec2 to,
       if (p.x < lim_min.x || p.y < lim_min.y || p.x >= lim_max.x || p.y >= lim_max.y)
         return;
       size_t idx = coord_to_idx(p.x, p.y, dd.width);
-      // not empty
-      if (dd.tiles[idx] == dungeon::wall)
+      // not empty or agent doesn't fit
+      if (!is_fitting(dd, idx, agent_size))
         return;
       float edgeWeight = 1.f;
       float gScore = getG(curPos) + 1.f * edgeWeight; // we're exactly 1 unit away
@@ -121,7 +142,7 @@ std::vector<IVec2> find_path_a_star(const DungeonData &dd, IVec2 from, IVec2 to,
     checkNeighbour({curPos.x + 0, curPos.y - 1});
   }
   // empty path
-  return std::vector<IVec2>();
+  return CompactPath();
 }
 
 
@@ -224,49 +245,61 @@ void prebuild_map(flecs::world &ecs)
           for (size_t j = i + 1; j < indices.size(); ++j)
           {
             PathPortal &secondPortal = portals[indices[j]];
-            // check path from i to j
+            // check path from i to j for every size class, larger agents only start and end where they fit
             // check each position (to find closest dist) (could be made more optimal)
-            bool noPath = false;
-            size_t minDist = 0xffffffff;
-            for (size_t fromY = std::max(firstPortal.startY, size_t(limMin.y));
-                        fromY <= std::min(firstPortal.endY, size_t(limMax.y - 1)) && !noPath; ++fromY)
+            size_t prevDist = 0xffffffff;
+            for (size_t agentSize = pathfinder::maxAgentSize; agentSize > 0; --agentSize)
             {
-              for (size_t fromX = std::max(firstPortal.startX, size_t(limMin.x));
-                          fromX <= std::min(firstPortal.endX, size_t(limMax.x - 1)) && !noPath; ++fromX)
+              bool noPath = false;
+              size_t minDist = 0xffffffff;
+              for (size_t fromY = std::max(firstPortal.startY, size_t(limMin.y));
+                          fromY <= std::min(firstPortal.endY, size_t(limMax.y - 1)) && !noPath; ++fromY)
               {
-                for (size_t toY = std::max(secondPortal.startY, size_t(limMin.y));
-                            toY <= std::min(secondPortal.endY, size_t(limMax.y - 1)) && !noPath; ++toY)
+                for (size_t fromX = std::max(firstPortal.startX, size_t(limMin.x));
+                            fromX <= std::min(firstPortal.endX, size_t(limMax.x - 1)) && !noPath; ++fromX)
                 {
-                  for (size_t toX = std::max(secondPortal.startX, size_t(limMin.x));
-                              toX <= std::min(secondPortal.endX, size_t(limMax.x - 1)) && !noPath; ++toX)
+                  if (!is_fitting(dd, coord_to_idx(fromX, fromY, dd.width), agentSize))
+                    continue;
+                  for (size_t toY = std::max(secondPortal.startY, size_t(limMin.y));
+                              toY <= std::min(secondPortal.endY, size_t(limMax.y - 1)) && !noPath; ++toY)
                   {
-                    IVec2 from{int(fromX), int(fromY)};
-                    IVec2 to{int(toX), int(toY)};
-                    std::vector<IVec2> path = find_path_a_star(dd, from, to, limMin, limMax);
-                    if (path.empty() && from != to)
+                    for (size_t toX = std::max(secondPortal.startX, size_t(limMin.x));
+                                toX <= std::min(secondPortal.endX, size_t(limMax.x - 1)) && !noPath; ++toX)
                     {
-                      noPath = true; // if we found that there's no path at all - we can break out
-                      break;
+                      if (!is_fitting(dd, coord_to_idx(toX, toY, dd.width), agentSize))
+                        continue;
+                      IVec2 from{int(fromX), int(fromY)};
+                      IVec2 to{int(toX), int(toY)};
+                      CompactPath path = find_path_a_star(dd, from, to, limMin, limMax, agentSize);
+                      if (path.empty() && from != to)
+                      {
+                        noPath = true; // if we found that there's no path at all - we can break out
+                        break;
+                      }
+                      minDist = std::min(minDist, path.numSteps);
                     }
-                    minDist = std::min(minDist, path.size());
                   }
                 }
               }
+              // write pathable data and length, sizes with equal distance share the largest size connection
+              if (noPath || minDist == 0xffffffff || minDist == prevDist)
+                continue;
+              prevDist = minDist;
+              firstPortal.conns.push_back({indices[j], float(minDist), agentSize});
+              secondPortal.conns.push_back({indices[i], float(minDist), agentSize});
             }
-            // write pathable data and length
-            if (noPath)
-              continue;
-            firstPortal.conns.push_back({indices[j], float(minDist)});
-            secondPortal.conns.push_back({indices[i], float(minDist)});
           }
         }
       }
-      e.set(DungeonPortals{splitTiles, portals, tilePortalsIndices});
+      DungeonPortals dp{splitTiles, portals, tilePortalsIndices};
+      e.set(oracle::build(dd));
+      e.set(hdmap::create(dd, dp));
+      e.set(std::move(dp));
     });
   });
 }
 
-size_t find_dist_to_protal(const DungeonData &dd, const PathPortal &portal, IVec2 p)
+size_t find_dist_to_protal(const DungeonData &dd, const PathPortal &portal, IVec2 p, size_t agent_size)
 {
   size_t out = 0xFFFFFF;
   size_t splitTiles = pathfinder::splitTiles;
@@ -282,18 +315,21 @@ size_t find_dist_to_protal(const DungeonData &dd, const PathPortal &portal, IVec
                 startY <= std::min(portal.endY, size_t(limMax.y - 1)); ++startY)
     {
       IVec2 toPortal{ int(startX), int(startY) };
-      std::vector<IVec2> path = find_path_a_star(dd, p, toPortal, limMin, limMax);
+      if (!is_fitting(dd, coord_to_idx(startX, startY, dd.width), agent_size))
+        continue;
+      CompactPath path = find_path_a_star(dd, p, toPortal, limMin, limMax, agent_size);
       if (path.empty() && toPortal != p)
       {
         break;
       }
-      out = std::min(out, path.size());
+      out = std::min(out, path.numSteps);
     }
   return out;
 }
 
 //Use copy DungeonPortals for modification
-std::vector<PortalConnection> find_path_a_star_tiled(const DungeonData &dd, DungeonPortals dp, IVec2 from, IVec2 to)
+std::vector<PortalConnection> find_path_a_star_tiled(const DungeonData &dd, DungeonPortals dp, IVec2 from, IVec2 to,
+                                                     size_t agent_size)
 {
   if (from.x < 0 || from.y < 0 || from.x >= int(dd.width) || from.y >= int(dd.height))
     return std::vector<PortalConnection>();
@@ -316,22 +352,22 @@ std::vector<PortalConnection> find_path_a_star_tiled(const DungeonData &dd, Dung
   for (const int idx : dp.tilePortalsIndices[fromTileIdx])
   {
     PathPortal &portal = dp.portals[idx];
-    size_t gScore = find_dist_to_protal(dd, portal, from);
+    size_t gScore = find_dist_to_protal(dd, portal, from, agent_size);
     IVec2 portalPos = { (portal.startX + portal.endX + 1) * 0.5f,
                         (portal.startY + portal.endY + 1) * 0.5f };
     prev[idx] = fromIdx;
     g[idx] = gScore;
     f[idx] = gScore + heuristic(portalPos, to);
     openList.emplace_back(idx);
-    portal.conns.push_back({ fromIdx, (float)gScore });
+    portal.conns.push_back({ fromIdx, (float)gScore, agent_size });
   }
 
   size_t toTileIdx = coord_to_tile_idx(to.x, to.y, dd.width);
   for (const int idx : dp.tilePortalsIndices[toTileIdx])
   {
     PathPortal &portal = dp.portals[idx];
-    float dist = find_dist_to_protal(dd, portal, to);
-    portal.conns.push_back({ toIdx, dist });
+    float dist = find_dist_to_protal(dd, portal, to, agent_size);
+    portal.conns.push_back({ toIdx, dist, agent_size });
   }
 
   while (!openList.empty())
@@ -348,7 +384,7 @@ std::vector<PortalConnection> find_path_a_star_tiled(const DungeonData &dd, Dung
       }
     }
     if (openList[bestIdx] == toIdx)
-      return reconstruct_path(dp, prev);
+      return reconstruct_path(dp, prev, agent_size);
     size_t curPos = openList[bestIdx];
     openList.erase(openList.begin() + bestIdx);
     if (std::find(closedList.begin(), closedList.end(), curPos) != closedList.end())
@@ -357,6 +393,9 @@ std::vector<PortalConnection> find_path_a_star_tiled(const DungeonData &dd, Dung
 
     auto checkNeighbour = [&](const PortalConnection &pc)
     {
+      // connection is too narrow for this agent
+      if (pc.clearance < agent_size)
+        return;
       float gScore = g[curPos] + pc.score;
       if (gScore < g[pc.connIdx])
       {
@@ -387,5 +426,6 @@ std::vector<PortalConnection> find_path_a_star_tiled(const DungeonData &dd, Dung
       checkNeighbour(pc);
     }
   }
+  return std::vector<PortalConnection>();
 }
 
@@ -3,12 +3,16 @@
 #include <vector>
 #include "math.h"
 #include "pathfinderUtils.h"
+#include "compactPath.h"
 #include "ecsTypes.h"
 
+// there may be several connections between two portals, one per size class with distinct distance,
+// each is valid for agents up to its clearance
 struct PortalConnection
 {
   size_t connIdx;
   float score;
+  size_t clearance = 1;
 };
 
 struct PathPortal
@@ -32,7 +36,10 @@ static size_t coord_to_tile_idx(T x, T y, size_t w)
   return size_t(y) / pathfinder::splitTiles * w / pathfinder::splitTiles + size_t(x) / pathfinder::splitTiles;
 }
 
-std::vector<IVec2> find_path_a_star(const DungeonData &dd, IVec2 from, IVec2 to, IVec2 lim_min, IVec2 lim_max);
+// agent_size is a side of square footprint anchored at its top left tile
+CompactPath find_path_a_star(const DungeonData &dd, IVec2 from, IVec2 to, IVec2 lim_min, IVec2 lim_max,
+                             size_t agent_size = 1);
 void prebuild_map(flecs::world &ecs);
-std::vector<PortalConnection> find_path_a_star_tiled(const DungeonData &dd, DungeonPortals dp, IVec2 from, IVec2 to);
+std::vector<PortalConnection> find_path_a_star_tiled(const DungeonData &dd, DungeonPortals dp, IVec2 from, IVec2 to,
+                                                     size_t agent_size = 1);
 
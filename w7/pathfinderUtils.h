@@ -1,6 +1,8 @@
 #pragma once
+#include <cstddef>
 
 namespace pathfinder
 {
   constexpr size_t splitTiles = 10;
+  constexpr size_t maxAgentSize = 3; // largest square footprint portal graph is annotated for
 }
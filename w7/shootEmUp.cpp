@@ -6,9 +6,16 @@
 #include "dungeonGen.h"
 #include "dungeonUtils.h"
 #include "pathfinder.h"
+#include "hierarchicalDmap.h"
 
 constexpr float tile_size = 64.f;
 
+// tile under the center of a sprite
+static IVec2 to_tile(const Position &p)
+{
+  return IVec2{int(floorf(p.x / tile_size + 0.5f)), int(floorf(p.y / tile_size + 0.5f))};
+}
+
 static void register_roguelike_systems(flecs::world &ecs)
 {
   static auto playerPosQuery = ecs.query<const Position, const IsPlayer>();
@@ -71,13 +78,65 @@ static void register_roguelike_systems(flecs::world &ecs)
           constexpr int angRandMax = 1 << 16;
           const float angle = float(GetRandomValue(0, angRandMax)) / float(angRandMax) * PI * 2.f;
           Color col = colors[st];
-          steer::create_steer_beh(create_monster(ecs,
+          flecs::entity monster = steer::create_steer_beh(create_monster(ecs,
               {pp.x + cosf(angle) * dist, pp.y + sinf(angle) * dist}, col, "minotaur_tex"), st);
+          if (st == steer::StSeeker)
+            monster.add<HdmapFollower>();
           ms.timeToSpawn += ms.timeBetweenSpawns;
         }
       });
     });
 
+  // goal is the player tile, fine level is kept only around followers
+  static auto followerPosQuery = ecs.query<const Position, const HdmapFollower>();
+  ecs.system<HierarchicalDmap, const DungeonData>()
+    .each([&](HierarchicalDmap &hd, const DungeonData &dd)
+    {
+      playerPosQuery.each([&](const Position &pp, const IsPlayer &)
+      {
+        const IVec2 playerTile = to_tile(pp);
+        if (hd.goals.size() != 1 || hd.goals[0] != playerTile)
+          hdmap::set_goals(hd, dd, {playerTile});
+      });
+      std::vector<IVec2> agents;
+      followerPosQuery.each([&](const Position &p, const HdmapFollower &) { agents.push_back(to_tile(p)); });
+      hdmap::update_active(hd, dd, agents);
+    });
+
+  // followers steer to the lowest neighbour tile, outside of the map they seek the player directly
+  static auto hdmapQuery = ecs.query<HierarchicalDmap, const DungeonData>();
+  ecs.system<SteerDir, const MoveSpeed, const Velocity, const Position, const HdmapFollower>()
+    .each([&](SteerDir &sd, const MoveSpeed &ms, const Velocity &vel, const Position &p, const HdmapFollower &)
+    {
+      hdmapQuery.each([&](HierarchicalDmap &hd, const DungeonData &dd)
+      {
+        const IVec2 tile = to_tile(p);
+        IVec2 target = tile;
+        float bestDist = hdmap::get(hd, dd, tile);
+        const IVec2 offsets[] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        for (const IVec2 &offs : offsets)
+        {
+          const IVec2 next{tile.x + offs.x, tile.y + offs.y};
+          const float nextDist = hdmap::get(hd, dd, next);
+          if (nextDist < bestDist)
+          {
+            bestDist = nextDist;
+            target = next;
+          }
+        }
+        if (bestDist < hdmap::invalid_tile_value)
+        {
+          const Position targetPos = Position{float(target.x), float(target.y)} * tile_size;
+          sd += SteerDir{normalize(targetPos - p) * ms.speed - vel};
+          return;
+        }
+        playerPosQuery.each([&](const Position &pp, const IsPlayer &)
+        {
+          sd += SteerDir{normalize(pp - p) * ms.speed - vel};
+        });
+      });
+    });
+
   static auto cameraQuery = ecs.query<const Camera2D>();
   ecs.system<const DungeonPortals, const DungeonData>()
     .each([&](const DungeonPortals &dp, const DungeonData &dd)
@@ -175,8 +234,10 @@ void init_dungeon(flecs::world &ecs, char *tiles, size_t w, size_t h)
   for (size_t y = 0; y < h; ++y)
     for (size_t x = 0; x < w; ++x)
       dungeonData[y * w + x] = tiles[y * w + x];
+  DungeonData dd{dungeonData, w, h, {}};
+  dungeon::compute_clearance(dd);
   ecs.entity("dungeon")
-    .set(DungeonData{dungeonData, w, h});
+    .set(dd);
 
   for (size_t y = 0; y < h; ++y)
     for (size_t x = 0; x < w; ++x)
@@ -85,6 +85,7 @@ void steer::register_systems(flecs::world &ecs)
 
   // seeker
   ecs.system<SteerDir, const MoveSpeed, const Velocity, const Position, const Seeker>()
+    .term<HdmapFollower>().not_()
     .each([&](SteerDir &sd, const MoveSpeed &ms, const Velocity &vel,
               const Position &p, const Seeker &)
     {